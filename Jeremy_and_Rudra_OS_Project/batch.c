@@ -0,0 +1,478 @@
+#include "crawler.h"
+#include <poll.h>
+
+// ============================================================================
+// BATCH QUERY MODE
+// ============================================================================
+
+// Each query runs the same priority-first search as crawl_worker, but over the
+// shared link graph, so a page is fetched and parsed at most once per batch no
+// matter how many queries pass through it. Queries run concurrently on a pool
+// of NUM_THREADS workers and each result is written as one JSON line. Results
+// come back in the order queries finish, so each one carries the number of the
+// input line it answers.
+//
+// A query expands one page at a time, so while it expands a page it hands the
+// next prefetch_budget pages at the top of its frontier to the shared
+// fetch-ahead threads (see graph.c). By the time the query gets to them, they
+// are usually in the graph already or on their way.
+
+// An entry in a query's frontier
+// order breaks priority ties so equal-priority pages come out first-in first-out,
+// like the sorted insert in enqueue()
+typedef struct {
+    URLQueueNode *node;
+    long order;
+} FrontierEntry;
+
+// State for a single query (only touched by the thread running it)
+typedef struct {
+    const char *target;
+    FrontierEntry *heap;            // Binary max-heap on (priority, -order)
+    int heap_count;
+    int heap_capacity;
+    long next_order;
+    VisitedNode *seen[HASH_TABLE_SIZE];  // URLs this query has already queued
+    URLQueueNode **nodes;           // Every node allocated, freed when the query ends
+    int node_count;
+    int node_capacity;
+} QuerySearch;
+
+// Input shared by the batch workers
+static FILE *batch_input;
+static long batch_line_number = 0;
+static pthread_mutex_t batch_input_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Guards wiki_base_from_query
+static pthread_mutex_t wiki_base_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Returns 1 if entry a should come out of the heap before entry b
+static int entry_before(FrontierEntry *a, FrontierEntry *b) {
+    if (a->node->priority != b->node->priority) {
+        return a->node->priority > b->node->priority;
+    }
+    return a->order < b->order;
+}
+
+// Add a node to the query's frontier
+static void frontier_push(QuerySearch *search, URLQueueNode *node) {
+    if (search->heap_count >= search->heap_capacity) {
+        search->heap_capacity = search->heap_capacity ? search->heap_capacity * 2 : 256;
+        search->heap = realloc(search->heap, sizeof(FrontierEntry) * search->heap_capacity);
+    }
+    
+    // Sift the new entry up to its place
+    int i = search->heap_count++;
+    FrontierEntry entry = { node, search->next_order++ };
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!entry_before(&entry, &search->heap[parent])) {
+            break;
+        }
+        search->heap[i] = search->heap[parent];
+        i = parent;
+    }
+    search->heap[i] = entry;
+}
+
+// Remove and return the highest priority node, or NULL if the frontier is empty
+static URLQueueNode *frontier_pop(QuerySearch *search) {
+    if (search->heap_count == 0) {
+        return NULL;
+    }
+    
+    URLQueueNode *top = search->heap[0].node;
+    FrontierEntry last = search->heap[--search->heap_count];
+    
+    // Sift the last entry down from the root
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= search->heap_count) {
+            break;
+        }
+        if (child + 1 < search->heap_count &&
+            entry_before(&search->heap[child + 1], &search->heap[child])) {
+            child++;
+        }
+        if (!entry_before(&search->heap[child], &last)) {
+            break;
+        }
+        search->heap[i] = search->heap[child];
+        i = child;
+    }
+    if (search->heap_count > 0) {
+        search->heap[i] = last;
+    }
+    
+    return top;
+}
+
+// Hand the best pages in the frontier to the fetch-ahead threads
+// The first entries of the heap are the next pages to come out, or close to them;
+// pages at the depth limit are skipped, since the query never expands them
+static void fetch_frontier_ahead(QuerySearch *search, int depth) {
+    for (int i = 0; i < search->heap_count && i < prefetch_budget; i++) {
+        URLQueueNode *node = search->heap[i].node;
+        if (node->depth < depth) {
+            request_outlinks(node->url);
+        }
+    }
+}
+
+// Record that a query has queued a URL
+// Returns 1 if it was new, 0 if the query had already seen it
+// The URL belongs to the link graph or the alias map, so it isn't copied
+static int query_mark_seen(QuerySearch *search, char *url) {
+    unsigned int index = hash_string(url);
+    
+    VisitedNode *current = search->seen[index];
+    while (current != NULL) {
+        if (strcmp(current->url, url) == 0) {
+            return 0;
+        }
+        current = current->next;
+    }
+    
+    VisitedNode *new_node = malloc(sizeof(VisitedNode));
+    new_node->url = url;
+    new_node->next = search->seen[index];
+    search->seen[index] = new_node;
+    return 1;
+}
+
+// Create a node for this query and remember it so it can be freed later
+static URLQueueNode *query_new_node(QuerySearch *search, char *url, int depth, URLQueueNode *parent) {
+    if (search->node_count >= search->node_capacity) {
+        search->node_capacity = search->node_capacity ? search->node_capacity * 2 : 256;
+        search->nodes = realloc(search->nodes, sizeof(URLQueueNode *) * search->node_capacity);
+    }
+    
+    URLQueueNode *node = malloc(sizeof(URLQueueNode));
+    node->url = url;
+    node->depth = depth;
+    node->priority = calculate_priority(url, search->target);
+    node->parent = parent;
+    node->next = NULL;
+    node->checkpoint_epoch = 0;
+    node->checkpoint_id = 0;
+    node->prefetched = 0;
+    
+    search->nodes[search->node_count++] = node;
+    return node;
+}
+
+// Free everything a query allocated (URLs belong to the graph)
+static void free_query_search(QuerySearch *search) {
+    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
+        VisitedNode *current = search->seen[i];
+        while (current != NULL) {
+            VisitedNode *next = current->next;
+            free(current);
+            current = next;
+        }
+    }
+    for (int i = 0; i < search->node_count; i++) {
+        free(search->nodes[i]);
+    }
+    free(search->nodes);
+    free(search->heap);
+    free(search);
+}
+
+// Write a string as a JSON string literal
+static void print_json_string(FILE *out, const char *str) {
+    fputc('"', out);
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Write the result of one query as a single JSON line
+// line is the query's input line number; target_node is NULL if no path was
+// found, and status says why the search ended
+// Only out is locked, so a client that reads slowly never holds up the others
+static void print_query_result(FILE *out, long line, const char *start, const char *target,
+                               int depth, URLQueueNode *target_node, const char *status,
+                               int expanded, double seconds) {
+    flockfile(out);
+    
+    fprintf(out, "{\"line\":%ld,\"start\":", line);
+    print_json_string(out, start);
+    fprintf(out, ",\"target\":");
+    print_json_string(out, target);
+    fprintf(out, ",\"depth\":%d,\"found\":%s,\"status\":\"%s\",\"path\":[",
+            depth, target_node ? "true" : "false", status);
+    
+    // Collect the path from target back to start, then print it forwards
+    int path_length = 0;
+    for (URLQueueNode *current = target_node; current != NULL; current = current->parent) {
+        path_length++;
+    }
+    URLQueueNode **path = malloc(sizeof(URLQueueNode *) * (path_length + 1));
+    URLQueueNode *current = target_node;
+    for (int i = path_length - 1; i >= 0; i--) {
+        path[i] = current;
+        current = current->parent;
+    }
+    for (int i = 0; i < path_length; i++) {
+        if (i > 0) {
+            fprintf(out, ",");
+        }
+        print_json_string(out, path[i]->url);
+    }
+    free(path);
+    
+    fprintf(out, "],\"pages_expanded\":%d,\"seconds\":%.3f}\n", expanded, seconds);
+    fflush(out);
+    
+    funlockfile(out);
+}
+
+// Returns 1 if the client on fd has hung up (used to cancel its query)
+// A client that only shut down its writing side (echo ... | socat) is still
+// waiting for its results, so read-EOF alone doesn't count; on a Unix socket
+// POLLHUP is only reported once the client has closed both directions
+static int client_hung_up(int fd) {
+    struct pollfd pfd = { fd, 0, 0 };
+    if (poll(&pfd, 1, 0) <= 0) {
+        return 0;
+    }
+    return (pfd.revents & (POLLHUP | POLLERR)) != 0;
+}
+
+// Check whether a query should give up
+// deadline is a monotonic_seconds() time (0 = none) and cancel_fd the client
+// socket (-1 = none)
+// Returns "timeout" or "cancelled", or NULL to keep going
+const char *query_stop_reason(double deadline, int cancel_fd) {
+    if (deadline > 0 && monotonic_seconds() > deadline) {
+        return "timeout";
+    }
+    if (cancel_fd >= 0 && client_hung_up(cancel_fd)) {
+        return "cancelled";
+    }
+    return NULL;
+}
+
+// Find a path from start to target using the shared link graph
+// Prints the result as a JSON line to out, tagged with the input line number
+// The search stops early once limits->timeout seconds have passed or the
+// client on limits->cancel_fd hangs up (limits may be NULL for no limits)
+// Waiting for a page another query is fetching gives up on time, but this
+// query's own fetch is allowed to finish, so a deadline can be overrun by up
+// to one fetch timeout
+void run_query(FILE *out, long line, const char *start, const char *target, int depth,
+               QueryLimits *limits) {
+    double begin = monotonic_seconds();
+    double deadline = (limits && limits->timeout > 0) ? begin + limits->timeout : 0;
+    int cancel_fd = limits ? limits->cancel_fd : -1;
+    const char *status = "not_found";
+    
+    // Pages are compared by their canonical URLs, following known redirects
+    char canonical[2048], target_canonical[2048];
+    canonicalize_url(target, canonical, sizeof(canonical));
+    snprintf(target_canonical, sizeof(target_canonical), "%s", resolve_link(canonical));
+    canonicalize_url(start, canonical, sizeof(canonical));
+    
+    QuerySearch *search = calloc(1, sizeof(QuerySearch));
+    search->target = target_canonical;
+    
+    // Query nodes point at URLs owned by the graph, so intern the start page too
+    char *start_copy = strdup(resolve_link(canonical));
+    URLQueueNode *target_node = NULL;
+    int expanded = 0;
+    
+    URLQueueNode *root = query_new_node(search, start_copy, 0, NULL);
+    query_mark_seen(search, start_copy);
+    if (strcmp(start_copy, target_canonical) == 0) {
+        target_node = root;
+    } else {
+        frontier_push(search, root);
+    }
+    
+    URLQueueNode *node;
+    while (target_node == NULL && (node = frontier_pop(search)) != NULL) {
+        if (node->depth >= depth) {
+            continue;
+        }
+        
+        // Give up if the query ran out of time or its client went away
+        const char *stop = query_stop_reason(deadline, cancel_fd);
+        if (stop != NULL) {
+            status = stop;
+            break;
+        }
+        
+        // Let the next pages download while this one is fetched and expanded
+        fetch_frontier_ahead(search, depth);
+        
+        // NULL is a failed fetch, or a wait for another query's fetch that
+        // was given up for one of the reasons above
+        URLList *links = get_outlinks(node->url, deadline, cancel_fd);
+        if (links == NULL) {
+            stop = query_stop_reason(deadline, cancel_fd);
+            if (stop != NULL) {
+                status = stop;
+                break;
+            }
+            continue;
+        }
+        expanded++;
+        METRIC_ADD(pages, 1);
+        
+        // A page that redirected may be the target, or an article already seen
+        char *redirect = (char *)resolve_alias(node->url);
+        if (redirect != NULL) {
+            if (strcmp(redirect, target_canonical) == 0) {
+                target_node = query_new_node(search, redirect, node->depth, node->parent);
+                break;
+            }
+            if (!query_mark_seen(search, redirect)) {
+                continue;
+            }
+        }
+        
+        for (int i = 0; i < links->count; i++) {
+            // Links are already canonical; follow any redirect we know about
+            char *link = (char *)resolve_link(links->urls[i]);
+            
+            if (is_blacklisted(link) || !query_mark_seen(search, link)) {
+                continue;
+            }
+            
+            URLQueueNode *child = query_new_node(search, link, node->depth + 1, node);
+            if (strcmp(link, target_canonical) == 0) {
+                target_node = child;
+                break;
+            }
+            frontier_push(search, child);
+        }
+    }
+    
+    if (target_node != NULL) {
+        status = "found";
+    }
+    
+    // Nobody is listening for a cancelled query
+    if (strcmp(status, "cancelled") != 0) {
+        print_query_result(out, line, start, target, depth, target_node, status,
+                           expanded, monotonic_seconds() - begin);
+    }
+    
+    free_query_search(search);
+    free(start_copy);
+}
+
+// Parse and run one query line: "<url-1> <url-2> <depth> [timeout-seconds]"
+// Blank lines and lines starting with # are skipped; bad lines get an error line
+// line_number is the line's position in the input (from 1), echoed in the result
+// limits->timeout is used when the line doesn't give its own timeout
+void handle_query_line(FILE *out, char *line, long line_number, QueryLimits *limits) {
+    char start[2048], target[2048];
+    
+    // Skip blank lines and comments
+    char *text = line;
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    if (*text == '\0' || *text == '\n' || *text == '\r' || *text == '#') {
+        return;
+    }
+    
+    int depth;
+    double timeout = limits ? limits->timeout : 0;
+    int fields = sscanf(text, "%2047s %2047s %d %lf", start, target, &depth, &timeout);
+    if (fields < 3 || depth <= 0 || timeout < 0) {
+        text[strcspn(text, "\r\n")] = '\0';
+        flockfile(out);
+        fprintf(out, "{\"line\":%ld,\"error\":\"invalid query\",\"query\":", line_number);
+        print_json_string(out, text);
+        fprintf(out, "}\n");
+        fflush(out);
+        funlockfile(out);
+        return;
+    }
+    
+    // Without --base-url, links resolve against the site of the first query;
+    // every query passes through the lock, so none runs before this is set
+    pthread_mutex_lock(&wiki_base_lock);
+    if (wiki_base_from_query) {
+        set_wiki_base_from_url(start);
+        wiki_base_from_query = 0;
+    }
+    pthread_mutex_unlock(&wiki_base_lock);
+    
+    QueryLimits query_limits = { timeout, limits ? limits->cancel_fd : -1 };
+    run_query(out, line_number, start, target, depth, &query_limits);
+}
+
+// Batch worker - reads query lines until the input runs out
+static void *batch_worker(void *arg) {
+    (void)arg; // Unused parameter
+    
+    char line[4096];
+    
+    while (1) {
+        // Number the line while still holding the lock, so numbers follow the input
+        pthread_mutex_lock(&batch_input_lock);
+        char *got = fgets(line, sizeof(line), batch_input);
+        long line_number = ++batch_line_number;
+        pthread_mutex_unlock(&batch_input_lock);
+        
+        if (got == NULL) {
+            break;
+        }
+        
+        handle_query_line(stdout, line, line_number, NULL);
+    }
+    
+    return NULL;
+}
+
+// Run every query in a file ("-" for stdin) on a pool of worker threads
+// Returns 0 on success, 1 if the input could not be opened
+int run_batch(const char *path) {
+    if (strcmp(path, "-") == 0) {
+        batch_input = stdin;
+    } else {
+        batch_input = fopen(path, "r");
+        if (batch_input == NULL) {
+            fprintf(stderr, "Error: Cannot open query file %s\n", path);
+            return 1;
+        }
+    }
+    
+    start_fetch_ahead();
+    
+    pthread_t threads[NUM_THREADS];
+    int started = 0;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, NULL) != 0) {
+            fprintf(stderr, "Error creating thread %d\n", i);
+            break;
+        }
+        started++;
+    }
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    stop_fetch_ahead();
+    
+    if (batch_input != stdin) {
+        fclose(batch_input);
+    }
+    
+    fprintf(stderr, "Batch finished: %d pages fetched into the shared link graph\n", link_graph.page_count);
+    return started > 0 ? 0 : 1;
+}
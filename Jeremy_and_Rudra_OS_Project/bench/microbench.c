@@ -0,0 +1,174 @@
+#include "crawler.h"
+
+// ============================================================================
+// MICROBENCHMARKS (hot-path functions, no network)
+// ============================================================================
+
+// Build with every crawler source except main.c (globals.c supplies the
+// crawler's globals), for example:
+//   gcc -O2 -pthread -I.. -o microbench microbench.c $(ls ../*.c | grep -v main.c) -lcurl -lgumbo
+// Run:
+//   ./microbench [page.html]
+// With no argument a synthetic page with 500 links is used.
+// It runs in a scratch directory under /tmp, so it never touches ./.cache.
+// Set MICROBENCH_STDIO=1 to time the page cache without io_uring.
+
+// Number of URLs used by the queue, visited set and priority benchmarks
+#define BENCH_URLS 20000
+// Pages written to the cache for the read_from_cache benchmark
+#define BENCH_CACHED_PAGES 200
+
+// Print one result line: total time and time per operation
+static void report(const char *name, long long start_ns, long operations) {
+    long long elapsed = now_ns() - start_ns;
+    printf("%-28s %10ld ops %10.3f ms %10.1f ns/op\n",
+           name, operations, elapsed / 1e6, (double)elapsed / operations);
+}
+
+// Build a page that looks like a Wikipedia article with the given number of links
+static char *synthetic_page(int links) {
+    size_t capacity = (size_t)links * 700 + 1024;
+    char *html = malloc(capacity);
+    size_t length = 0;
+    
+    length += snprintf(html + length, capacity - length,
+                       "<html><head><title>Bench</title></head><body><div>");
+    for (int i = 0; i < links; i++) {
+        length += snprintf(html + length, capacity - length,
+                           "<p>Some ordinary article text about the history of the river valley "
+                           "and the university that stands near it, written to pad the page out "
+                           "to a realistic size. <a href=\"/wiki/Article_%d%s\">Article %d</a> "
+                           "<a href=\"/wiki/File:Picture_%d.jpg\">file</a></p>",
+                           i, i % 17 == 0 ? "#History" : "", i, i);
+    }
+    length += snprintf(html + length, capacity - length, "</div></body></html>");
+    return html;
+}
+
+// Read a whole file into memory, or return NULL
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *content = malloc(size + 1);
+    size_t got = fread(content, 1, size, f);
+    content[got] = '\0';
+    fclose(f);
+    return content;
+}
+
+int main(int argc, char *argv[]) {
+    char *html = argc > 1 ? read_file(argv[1]) : synthetic_page(500);
+    cache_io_uring = getenv("MICROBENCH_STDIO") == NULL;
+    target_url = "https://en.wikipedia.org/wiki/Rutgers_University-Camden";
+    max_depth = 6;
+    log_pages = 0;
+    if (html == NULL) {
+        fprintf(stderr, "Error: Cannot read %s\n", argv[1]);
+        return 1;
+    }
+    
+    // The visited set and the page cache both write under ./.cache, so work
+    // in a scratch directory instead of wherever we were started
+    char scratch[] = "/tmp/crawler-microbench-XXXXXX";
+    if (mkdtemp(scratch) == NULL || chdir(scratch) != 0) {
+        fprintf(stderr, "Error: Cannot create a scratch directory\n");
+        return 1;
+    }
+    
+    // Article URLs shared by the remaining benchmarks
+    char **urls = malloc(sizeof(char *) * BENCH_URLS);
+    for (int i = 0; i < BENCH_URLS; i++) {
+        char url[256];
+        snprintf(url, sizeof(url), "https://en.wikipedia.org/wiki/%s_%d",
+                 i % 3 == 0 ? "New_Jersey_Route" : (i % 3 == 1 ? "Camden_County_College" : "Linux"),
+                 i);
+        urls[i] = strdup(url);
+    }
+    
+    init_queue();
+    if (init_visited_set() != 0) {
+        return 1;
+    }
+    
+    // parse_html: whole page, gumbo parse plus link extraction
+    int rounds = 50;
+    int links_found = 0;
+    long long start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        URLList *links = parse_html(NULL, html);
+        links_found = links->count;
+        free_url_list(links);
+    }
+    report("parse_html (per page)", start, rounds);
+    printf("  page is %zu bytes with %d article links\n", strlen(html), links_found);
+    
+    // calculate_priority
+    volatile int sink = 0;
+    start = now_ns();
+    for (int i = 0; i < BENCH_URLS; i++) {
+        sink += calculate_priority(urls[i], target_url);
+    }
+    report("calculate_priority", start, BENCH_URLS);
+    
+    // mark_visited then is_visited (half hits, half misses)
+    start = now_ns();
+    for (int i = 0; i < BENCH_URLS; i += 2) {
+        mark_visited(urls[i]);
+    }
+    report("mark_visited", start, BENCH_URLS / 2);
+    
+    start = now_ns();
+    for (int i = 0; i < BENCH_URLS; i++) {
+        sink += is_visited(urls[i]);
+    }
+    report("is_visited (50% hits)", start, BENCH_URLS);
+    
+    // enqueue everything, then drain the queue
+    start = now_ns();
+    for (int i = 0; i < BENCH_URLS; i++) {
+        enqueue(urls[i], 1, NULL);
+    }
+    report("enqueue", start, BENCH_URLS);
+    
+    start = now_ns();
+    for (int i = 0; i < BENCH_URLS; i++) {
+        URLQueueNode *node = dequeue(-1);
+        finish_node(-1);
+        free(node->url);
+        free(node);
+    }
+    report("dequeue", start, BENCH_URLS);
+    
+    // read_from_cache on a warm page cache
+    init_cache();
+    for (int i = 0; i < BENCH_CACHED_PAGES; i++) {
+        write_to_cache(urls[i], html);
+    }
+    flush_cache_writes();
+    start = now_ns();
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < BENCH_CACHED_PAGES; i++) {
+            free_page(read_from_cache(urls[i]));
+        }
+    }
+    report(cache_io_uring ? "read_from_cache (io_uring)" : "read_from_cache (stdio)", start,
+           10 * BENCH_CACHED_PAGES);
+    
+    // Remove the scratch directory (the visited set's files are already unlinked)
+    for (int i = 0; i < BENCH_CACHED_PAGES; i++) {
+        char filename[512];
+        url_to_cache_filename(urls[i], filename, sizeof(filename));
+        unlink(filename);
+    }
+    if (rmdir(CACHE_DIR) != 0 || chdir("/") != 0 || rmdir(scratch) != 0) {
+        fprintf(stderr, "Warning: Could not remove %s\n", scratch);
+    }
+    
+    (void)sink;
+    return 0;
+}
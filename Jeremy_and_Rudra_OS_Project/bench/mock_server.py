@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Local mock Wikipedia server for benchmarks.
+
+Serves the synthetic graph from wikigen.py at /wiki/<title>, adding a
+configurable response latency with random jitter so that runs behave like
+the network-bound crawls against the real site. Every article also has a
+redirect title, served either as a 301 or, like Wikipedia, as a 200 with the
+article's content and canonical link.
+
+    python3 mock_server.py --port 8080 --pages 20000 --latency-ms 80 --jitter-ms 40
+"""
+
+import argparse
+import http.server
+import random
+import sys
+import threading
+import time
+from urllib.parse import unquote
+
+from wikigen import WikiGraph
+
+
+def make_handler(graph, latency_ms, jitter_ms, cache):
+    lock = threading.Lock()
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def do_GET(self):
+            if not self.path.startswith("/wiki/"):
+                self.send_error(404)
+                return
+            title = unquote(self.path[len("/wiki/"):].split("#")[0])
+            base = "http://%s" % self.headers.get("Host", "127.0.0.1:%d" % self.server.server_port)
+            page = graph.index.get(title)
+            redirect = page is None and title in graph.redirects
+            if redirect:
+                page = graph.redirects[title]
+            if page is None:
+                self.send_error(404)
+                return
+
+            delay = latency_ms + random.uniform(-jitter_ms, jitter_ms)
+            if delay > 0:
+                time.sleep(delay / 1000.0)
+
+            if redirect and graph.redirect_status(page) == 301:
+                self.send_response(301)
+                self.send_header("Location", "%s/wiki/%s" % (base, graph.titles[page]))
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+
+            with lock:
+                body = cache.get(page)
+            if body is None:
+                body = graph.html(page, base).encode()
+                with lock:
+                    cache[page] = body
+
+            self.send_response(200)
+            self.send_header("Content-Type", "text/html; charset=UTF-8")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def log_message(self, format, *args):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--pages", type=int, default=20000, help="articles in the graph")
+    parser.add_argument("--mean-links", type=int, default=150, help="average links per article")
+    parser.add_argument("--mean-kb", type=int, default=80, help="average article size in KB")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--latency-ms", type=float, default=0, help="added latency per response")
+    parser.add_argument("--jitter-ms", type=float, default=0, help="+/- random jitter on the latency")
+    args = parser.parse_args()
+
+    graph = WikiGraph(args.pages, args.mean_links, args.mean_kb, args.seed)
+    handler = make_handler(graph, args.latency_ms, args.jitter_ms, {})
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", args.port), handler)
+    server.daemon_threads = True
+    print("Serving %d pages on http://127.0.0.1:%d/wiki/" % (args.pages, server.server_port), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
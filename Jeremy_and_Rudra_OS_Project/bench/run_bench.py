@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""End-to-end crawler benchmark against the local mock Wikipedia server.
+
+Starts mock_server.py, picks start/target pairs a known number of hops apart
+in the synthetic graph, runs the crawler on each with a cold page cache, and
+reports time to path, pages/s, peak RSS and lock wait time (from the
+crawler's --metrics output). An exhaustive crawl with an unreachable target
+measures raw throughput.
+
+    python3 run_bench.py                      # build ../crawler into build/ and run
+    python3 run_bench.py --hops 2 3 4 --runs 3 --latency-ms 80 --jitter-ms 40
+    python3 run_bench.py --crawler ../crawler --json results.json
+    python3 run_bench.py --crawler-arg=--prefetch --crawler-arg=8
+    python3 run_bench.py --micro              # only the hot-path microbenchmarks
+"""
+
+import argparse
+import json
+import os
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+from wikigen import WikiGraph
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+SOURCE_DIR = os.path.dirname(BENCH_DIR)
+
+
+def library_flags():
+    """Compiler and linker flags for libcurl and gumbo, via pkg-config if available."""
+    try:
+        out = subprocess.run(["pkg-config", "--cflags", "--libs", "libcurl", "gumbo"],
+                             check=True, capture_output=True, text=True).stdout
+        return out.split()
+    except (OSError, subprocess.CalledProcessError):
+        return ["-lcurl", "-lgumbo"]
+
+
+def build(output, sources):
+    cmd = ["gcc", "-Wall", "-Wextra", "-pthread", "-O2", "-I", SOURCE_DIR, "-o", output]
+    cmd += sources + library_flags()
+    print("Building:", " ".join(cmd), file=sys.stderr)
+    subprocess.run(cmd, check=True)
+
+
+def crawler_sources():
+    return sorted(os.path.join(SOURCE_DIR, f) for f in os.listdir(SOURCE_DIR) if f.endswith(".c"))
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def start_server(args, port):
+    cmd = [sys.executable, os.path.join(BENCH_DIR, "mock_server.py"), "--port", str(port),
+           "--pages", str(args.pages), "--mean-links", str(args.mean_links),
+           "--mean-kb", str(args.mean_kb), "--seed", str(args.seed),
+           "--latency-ms", str(args.latency_ms), "--jitter-ms", str(args.jitter_ms)]
+    server = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+    server.stdout.readline()  # Wait for "Serving ..." so the port is open
+    return server
+
+
+def read_metrics(path):
+    """Parse the Prometheus text file written by --metrics into {name: value}."""
+    metrics = {}
+    if not os.path.exists(path):
+        return metrics
+    with open(path) as f:
+        for line in f:
+            if line.startswith("#") or not line.strip():
+                continue
+            name, value = line.rsplit(" ", 1)
+            metrics[name] = float(value)
+    return metrics
+
+
+def run_crawler(crawler, extra_args, start_url, target_url, depth, workdir, timeout):
+    """Run one crawl; returns a dict of measurements."""
+    metrics_path = os.path.join(workdir, "metrics.prom")
+    cmd = [crawler, "--quiet", "--metrics", metrics_path] + extra_args
+    cmd += [start_url, target_url, str(depth)]
+
+    began = time.monotonic()
+    proc = subprocess.Popen(cmd, cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                            text=True)
+    killer = threading.Timer(timeout, proc.kill)
+    killer.start()
+    output = proc.stdout.read()
+    # wait4 gives this child's own resource usage, including its peak RSS
+    _, status, usage = os.wait4(proc.pid, 0)
+    proc.returncode = status
+    killer.cancel()
+    elapsed = time.monotonic() - began
+
+    metrics = read_metrics(metrics_path)
+    path = [line for line in output.splitlines() if line.startswith("http")]
+    pages = metrics.get("crawler_pages_total", 0)
+    return {
+        "found": "No path found" not in output and len(path) > 0,
+        "path_length": max(0, len(path) - 1),
+        "seconds": elapsed,
+        "pages": int(pages),
+        "pages_per_second": pages / elapsed if elapsed > 0 else 0,
+        "peak_rss_mb": usage.ru_maxrss / 1024.0,
+        "queue_lock_wait_ms": metrics.get("crawler_enqueue_lock_wait_seconds_sum", 0) * 1000,
+        "visited_lock_wait_ms": metrics.get("crawler_visited_lock_wait_seconds_sum", 0) * 1000,
+        "fetch_seconds": metrics.get("crawler_fetch_seconds_sum", 0),
+        "parse_seconds": metrics.get("crawler_parse_seconds_sum", 0),
+    }
+
+
+def print_table(results):
+    header = "%-12s %5s %5s %9s %7s %9s %8s %11s %11s" % (
+        "case", "found", "hops", "seconds", "pages", "pages/s", "rss_mb", "queue_ms", "visited_ms")
+    print(header)
+    print("-" * len(header))
+    for r in results:
+        print("%-12s %5s %5d %9.2f %7d %9.1f %8.1f %11.2f %11.2f" % (
+            r["case"], "yes" if r["found"] else "no", r["path_length"], r["seconds"], r["pages"],
+            r["pages_per_second"], r["peak_rss_mb"], r["queue_lock_wait_ms"],
+            r["visited_lock_wait_ms"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--crawler", help="crawler binary (default: build one into bench/build)")
+    parser.add_argument("--pages", type=int, default=20000)
+    parser.add_argument("--mean-links", type=int, default=150)
+    parser.add_argument("--mean-kb", type=int, default=80)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--latency-ms", type=float, default=50)
+    parser.add_argument("--jitter-ms", type=float, default=25)
+    parser.add_argument("--hops", type=int, nargs="+", default=[2, 3],
+                        help="path lengths to benchmark")
+    parser.add_argument("--runs", type=int, default=1, help="queries per path length")
+    parser.add_argument("--exhaustive-depth", type=int, default=2,
+                        help="depth of the unreachable-target throughput run (0 to skip)")
+    parser.add_argument("--crawler-arg", action="append", default=[],
+                        help="extra option passed to the crawler (repeat for more)")
+    parser.add_argument("--timeout", type=float, default=600, help="seconds before a run is killed")
+    parser.add_argument("--warm", action="store_true",
+                        help="share one page cache across runs instead of starting cold")
+    parser.add_argument("--json", help="also write results to this file")
+    parser.add_argument("--micro", action="store_true",
+                        help="build and run the microbenchmarks instead of the crawl benchmark")
+    args = parser.parse_args()
+
+    if args.micro:
+        os.makedirs(os.path.join(BENCH_DIR, "build"), exist_ok=True)
+        microbench = os.path.join(BENCH_DIR, "build", "microbench")
+        sources = [s for s in crawler_sources() if os.path.basename(s) != "main.c"]
+        build(microbench, [os.path.join(BENCH_DIR, "microbench.c")] + sources)
+        return subprocess.run([microbench]).returncode
+
+    crawler = args.crawler
+    if crawler is None:
+        os.makedirs(os.path.join(BENCH_DIR, "build"), exist_ok=True)
+        crawler = os.path.join(BENCH_DIR, "build", "crawler")
+        build(crawler, crawler_sources())
+    crawler = os.path.abspath(crawler)
+
+    graph = WikiGraph(args.pages, args.mean_links, args.mean_kb, args.seed)
+    port = free_port()
+    base = "http://127.0.0.1:%d/wiki/" % port
+
+    cases = []
+    for hops in args.hops:
+        for run in range(args.runs):
+            start, target = graph.pick_query(hops, seed=run)
+            cases.append(("path-%d#%d" % (hops, run), graph.titles[start], graph.titles[target],
+                          hops + 1))
+    if args.exhaustive_depth > 0:
+        # Start from the best-linked of a handful of ordinary pages so the crawl has work to do
+        start = max(range(args.pages // 2, args.pages // 2 + 50),
+                    key=lambda page: len(set(graph.links(page))))
+        cases.append(("exhaustive", graph.titles[start], "No_Such_Article", args.exhaustive_depth))
+
+    server = start_server(args, port)
+    shared_dir = tempfile.mkdtemp(prefix="crawler-bench-")
+    results = []
+    try:
+        for name, start, target, depth in cases:
+            workdir = shared_dir if args.warm else tempfile.mkdtemp(prefix="crawler-bench-")
+            result = run_crawler(crawler, args.crawler_arg, base + start, base + target, depth, workdir, args.timeout)
+            result["case"] = name
+            results.append(result)
+            if not args.warm:
+                shutil.rmtree(workdir, ignore_errors=True)
+    finally:
+        server.terminate()
+        server.wait()
+        shutil.rmtree(shared_dir, ignore_errors=True)
+
+    print_table(results)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"config": vars(args), "results": results}, f, indent=2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
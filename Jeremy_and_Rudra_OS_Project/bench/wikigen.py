@@ -0,0 +1,132 @@
+"""Synthetic Wikipedia graph generator.
+
+Builds a deterministic article graph (same seed = same graph) and renders
+article HTML that looks enough like Wikipedia to exercise the crawler:
+lognormal page sizes and link counts, a few heavily linked hub pages,
+links to special pages, #fragments, redirect titles, and plain filler text.
+"""
+
+import math
+import random
+from collections import deque
+
+WORDS = [
+    "river", "valley", "university", "college", "station", "railway", "church",
+    "county", "history", "battle", "treaty", "island", "mountain", "lake",
+    "school", "theory", "language", "kingdom", "empire", "museum", "festival",
+    "album", "film", "novel", "engine", "protocol", "system", "network",
+    "camden", "jersey", "linux", "unix", "bell", "labs", "computer", "science",
+    "physics", "chemistry", "biology", "music", "art", "road", "bridge", "port",
+]
+
+SPECIAL_PREFIXES = ["File:", "Category:", "Help:", "Special:", "Template:", "Talk:", "Portal:"]
+
+
+class WikiGraph:
+    """A random article graph with Wikipedia-like degree and size distributions."""
+
+    def __init__(self, pages=20000, mean_links=150, mean_kb=80, seed=1):
+        self.pages = pages
+        self.mean_links = mean_links
+        self.mean_kb = mean_kb
+        self.seed = seed
+        rng = random.Random(seed)
+        self.titles = [self._make_title(rng, i) for i in range(pages)]
+        self.index = {title: i for i, title in enumerate(self.titles)}
+        self.redirects = {self.redirect_title(i): i for i in range(pages)}
+
+    @staticmethod
+    def _make_title(rng, i):
+        words = rng.sample(WORDS, rng.randint(1, 3))
+        return "_".join(w.capitalize() for w in words) + "_%d" % i
+
+    def redirect_title(self, i):
+        """Another title for page i, like a Wikipedia redirect."""
+        return "Redirect_to_" + self.titles[i]
+
+    @staticmethod
+    def redirect_status(i):
+        """How the redirect to page i is served.
+
+        301 sends the client to the article's URL. 200 serves the article under
+        the redirect's URL, as Wikipedia does, and only its canonical link tells.
+        """
+        return 301 if i % 2 == 0 else 200
+
+    def _rng(self, i):
+        return random.Random(self.seed * 1000003 + i)
+
+    def links(self, i):
+        """Outgoing article indices of page i (may repeat, like real pages)."""
+        rng = self._rng(i)
+        # Lognormal link count with a median near mean_links / 1.3
+        count = int(rng.lognormvariate(math.log(self.mean_links) - 0.35, 0.8))
+        count = max(5, min(count, 5000))
+        # Squaring the uniform draw skews links toward low indices, which act as hubs
+        return [int(self.pages * rng.random() ** 2) for _ in range(count)]
+
+    def html(self, i, base=""):
+        """Render page i as an HTML document of roughly lognormal size.
+
+        base is the scheme and host put in front of the page's canonical link.
+        """
+        rng = self._rng(i)
+        targets = self.links(i)
+        size = int(rng.lognormvariate(math.log(self.mean_kb * 1024) - 0.3, 0.7))
+        title = self.titles[i]
+
+        parts = ["<!DOCTYPE html><html><head><title>%s - Wikipedia</title>" % title,
+                 "<link rel=\"canonical\" href=\"%s/wiki/%s\"></head><body>" % (base, title),
+                 "<h1>%s</h1><div id=\"mw-content-text\">" % title.replace("_", " ")]
+        filler_per_link = max(0, size // (len(targets) + 1) - 60)
+        for n, target in enumerate(targets):
+            href = "/wiki/" + self.titles[target]
+            if n % 13 == 6:
+                href = "/wiki/" + self.redirect_title(target)
+            if n % 17 == 0:
+                href += "#Section_%d" % n
+            parts.append("<p>%s <a href=\"%s\">%s</a></p>"
+                         % (self._filler(rng, filler_per_link), href, self.titles[target]))
+            if n % 11 == 0:
+                prefix = SPECIAL_PREFIXES[n % len(SPECIAL_PREFIXES)]
+                parts.append("<a href=\"/wiki/%sExample_%d\">x</a>" % (prefix, n))
+            if n % 23 == 0:
+                parts.append("<a href=\"https://example.org/ref/%d\">ref</a>" % n)
+        parts.append("</div></body></html>")
+        return "".join(parts)
+
+    @staticmethod
+    def _filler(rng, length):
+        words = []
+        total = 0
+        while total < length:
+            word = rng.choice(WORDS)
+            words.append(word)
+            total += len(word) + 1
+        return " ".join(words)
+
+    def distances_from(self, start, max_depth):
+        """BFS hop counts from start, up to max_depth."""
+        dist = {start: 0}
+        frontier = deque([start])
+        while frontier:
+            page = frontier.popleft()
+            if dist[page] >= max_depth:
+                continue
+            for target in self.links(page):
+                if target not in dist:
+                    dist[target] = dist[page] + 1
+                    frontier.append(target)
+        return dist
+
+    def pick_query(self, hops, seed=0):
+        """Pick (start, target) indices whose shortest path is exactly `hops` long."""
+        rng = random.Random(seed)
+        for _ in range(100):
+            # Start from a non-hub page, like a typical query would
+            start = rng.randrange(self.pages // 2, self.pages)
+            dist = self.distances_from(start, hops)
+            candidates = sorted(page for page, d in dist.items() if d == hops)
+            if candidates:
+                return start, rng.choice(candidates)
+        raise RuntimeError("no page pair %d hops apart; try a bigger graph" % hops)
@@ -1,27 +1,54 @@
 #include "crawler.h"
+#include <dirent.h>
 
 // ============================================================================
 // CACHING SYSTEM
 // ============================================================================
 
 // Initialize cache directory
+// Removes temporary files left by a run that was killed mid-write
 void init_cache() {
     mkdir(CACHE_DIR, 0755);  // Create if doesn't exist
+    
+    DIR *dir = opendir(CACHE_DIR);
+    if (!dir) {
+        return;
+    }
+    
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".tmp") == 0) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", CACHE_DIR, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(dir);
 }
 
 // Convert URL to cache filename
 // Uses hash of URL as filename to avoid filesystem issues with special chars
 void url_to_cache_filename(const char *url, char *filename, size_t size) {
-    unsigned int hash = hash_string(url);
-    snprintf(filename, size, "%s/%u.html", CACHE_DIR, hash);
+    // A full 64-bit hash: hash_string only has HASH_TABLE_SIZE values, so
+    // different pages would share a file and read back each other's HTML
+    unsigned long long hash = hash_url(url);
+    snprintf(filename, size, "%s/%016llx.html", CACHE_DIR, hash);
 }
 
 // Try to read HTML from cache
 // Returns cached HTML if found, NULL if not cached
+// Release the page with free_page(), since it may be an io_uring buffer
 char *read_from_cache(const char *url) {
     char filename[512];
     url_to_cache_filename(url, filename, sizeof(filename));
     
+    // io_uring reads straight into a buffer that is handed to the parser
+    char *content;
+    if (cache_uring_read(filename, &content)) {
+        return content;
+    }
+    
     FILE *f = fopen(filename, "r");
     if (!f) {
         return NULL;  // Not in cache
@@ -33,7 +60,7 @@ char *read_from_cache(const char *url) {
     fseek(f, 0, SEEK_SET);
     
     // Read entire file
-    char *content = malloc(size + 1);
+    content = malloc(size + 1);
     fread(content, 1, size, f);
     content[size] = '\0';
     
@@ -42,13 +69,32 @@ char *read_from_cache(const char *url) {
 }
 
 // Write HTML to cache
+// With io_uring the write finishes in the background, and the page appears
+// under its name once it is complete
 void write_to_cache(const char *url, const char *html) {
     char filename[512];
     url_to_cache_filename(url, filename, sizeof(filename));
     
+    if (cache_uring_write(filename, html)) {
+        return;
+    }
+    
     FILE *f = fopen(filename, "w");
     if (f) {
         fputs(html, f);
         fclose(f);
     }
 }
+
+// Wait until this thread's cache writes are on disk
+// Only needed before telling another thread that a page is cached
+void flush_cache_writes() {
+    cache_uring_flush();
+}
+
+// Free a page returned by fetch_url() or read_from_cache()
+void free_page(char *html) {
+    if (html != NULL && !cache_uring_release(html)) {
+        free(html);
+    }
+}
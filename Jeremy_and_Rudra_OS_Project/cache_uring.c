@@ -0,0 +1,637 @@
+#define _GNU_SOURCE     // For syscall() and MAP_POPULATE
+#include "crawler.h"
+
+// ============================================================================
+// IO_URING BACKEND FOR THE PAGE CACHE (Linux only)
+// ============================================================================
+
+// Each thread that touches the cache gets its own ring, set up the first time
+// it is needed, plus CACHE_URING_BUFFERS buffers registered with the kernel.
+// - Reads go straight into a registered buffer, which is handed to the parser
+//   as is and given back by free_page().
+// - Writes are copied into a registered buffer and submitted straight away,
+//   and the thread never waits for them. Each write goes to a temporary file,
+//   with a rename linked behind it, so the kernel moves the page into place
+//   as soon as it is written and no reader ever sees half a page. Kernels
+//   without IORING_OP_RENAMEAT (before 5.11) wait for the write and rename
+//   the file themselves.
+// - Finished writes are collected whenever the thread next uses its ring.
+//   A read of a page whose write is still in flight waits for that write.
+// If io_uring can't be set up (old kernel, seccomp, containers), or a thread's
+// ring fails later on, the caller falls back to the stdio code in cache.c.
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+// Submission queue entries per ring
+#define CACHE_URING_ENTRIES 64
+// Registered buffers per ring, and the size of each
+#define CACHE_URING_BUFFERS 8
+#define CACHE_URING_BUFFER_SIZE (512 * 1024)
+// Set in user_data for the rename linked behind a write
+#define CACHE_URING_RENAME_TAG 1
+
+// One read or write that has been submitted
+typedef struct CacheOp {
+    int is_write;
+    int done;                       // Set when the completion arrives (reads only)
+    int result;                     // Bytes transferred or -errno
+    int pending;                    // Completions still to come (writes only)
+    int linked_rename;              // The kernel renames the file after the write
+    int rename_result;              // 0 or -errno from the linked rename
+    int fd;
+    int slot;                       // Registered buffer in use, or -1
+    struct iovec iov;               // Data for unregistered I/O (big pages)
+    char *buffer;                   // malloc'd copy to free (big page writes)
+    size_t length;
+    char temp_path[544];            // Written here, then renamed to final_path
+    char final_path[512];
+    struct CacheOp *next;           // Next unfinished write on this ring
+} CacheOp;
+
+// A thread's ring and its registered buffers
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map, *cq_map;
+    size_t sq_map_size, cq_map_size, sqes_size;
+    unsigned to_submit;             // Entries queued but not yet submitted
+    int in_flight;                  // Submitted entries not yet completed
+    int writes_in_flight;
+    CacheOp *writes;                // Writes submitted but not finished
+    int can_rename;                 // Kernel supports IORING_OP_RENAMEAT
+    char *buffers;                  // CACHE_URING_BUFFERS * CACHE_URING_BUFFER_SIZE bytes
+    atomic_int buffer_used[CACHE_URING_BUFFERS];
+} CacheRing;
+
+// Every ring ever set up, so free_page() can tell which buffers are registered
+static _Atomic(CacheRing *) rings[MAX_METRIC_THREADS];
+static atomic_int ring_count;
+
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static atomic_int uring_failed;     // Set once io_uring turned out to be unavailable
+
+// Marks a thread whose ring couldn't be set up
+static CacheRing no_ring;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// Finish a write once all its completions have arrived: close the file and
+// make sure it ends up either in place or removed
+static void complete_write(CacheRing *ring, CacheOp *op) {
+    for (CacheOp **link = &ring->writes; *link != NULL; link = &(*link)->next) {
+        if (*link == op) {
+            *link = op->next;
+            break;
+        }
+    }
+    
+    close(op->fd);
+    if (op->result != (int)op->length) {
+        unlink(op->temp_path);          // A short write also cancels the linked rename
+    } else if (!op->linked_rename) {
+        rename(op->temp_path, op->final_path);
+    } else if (op->rename_result != 0) {
+        unlink(op->temp_path);
+    }
+    
+    if (op->slot >= 0) {
+        atomic_store(&ring->buffer_used[op->slot], 0);
+    }
+    free(op->buffer);
+    free(op);
+    ring->writes_in_flight--;
+}
+
+// Handle every completion waiting in the ring
+static void reap_completions(CacheRing *ring) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = atomic_load_explicit((_Atomic unsigned *)ring->cq_tail, memory_order_acquire);
+    
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        uintptr_t data = (uintptr_t)cqe->user_data;
+        CacheOp *op = (CacheOp *)(data & ~(uintptr_t)CACHE_URING_RENAME_TAG);
+        if (data & CACHE_URING_RENAME_TAG) {
+            op->rename_result = cqe->res;
+        } else {
+            op->result = cqe->res;
+        }
+        ring->in_flight--;
+        head++;
+        
+        if (!op->is_write) {
+            op->done = 1;
+        } else if (--op->pending == 0) {
+            complete_write(ring, op);
+        }
+    }
+    
+    atomic_store_explicit((_Atomic unsigned *)ring->cq_head, head, memory_order_release);
+}
+
+// Submit everything queued; if wait is set, block until at least one entry completes
+// Interrupted or temporarily busy calls return 0 having done nothing, so
+// callers simply go round their loop again
+// Returns 0 on success, -1 on error
+static int submit_queued(CacheRing *ring, int wait) {
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    int submitted = sys_io_uring_enter(ring->fd, ring->to_submit, wait ? 1 : 0, flags);
+    if (submitted < 0) {
+        // EBUSY means the completion queue is full; the caller's reap makes room
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            return 0;
+        }
+        return -1;
+    }
+    
+    ring->in_flight += submitted;
+    ring->to_submit -= submitted;
+    return 0;
+}
+
+// Get a free submission queue entry, making room if the ring is full
+// needed is the number of entries about to be queued together, so that a
+// linked pair is never split across two submissions
+static struct io_uring_sqe *get_sqe(CacheRing *ring, int needed) {
+    while (1) {
+        unsigned head = atomic_load_explicit((_Atomic unsigned *)ring->sq_head, memory_order_acquire);
+        unsigned tail = *ring->sq_tail;
+        if (tail - head + needed <= CACHE_URING_ENTRIES &&
+            ring->in_flight + (int)ring->to_submit + needed <= CACHE_URING_ENTRIES) {
+            struct io_uring_sqe *sqe = &ring->sqes[tail & *ring->sq_mask];
+            memset(sqe, 0, sizeof(*sqe));
+            return sqe;
+        }
+        
+        // Full - wait for something to finish
+        if (submit_queued(ring, 1) != 0) {
+            return NULL;
+        }
+        reap_completions(ring);
+    }
+}
+
+// Add a filled-in entry to the submission queue
+static void queue_sqe(CacheRing *ring, struct io_uring_sqe *sqe) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    ring->sq_array[index] = (unsigned)(sqe - ring->sqes);
+    atomic_store_explicit((_Atomic unsigned *)ring->sq_tail, tail + 1, memory_order_release);
+    ring->to_submit++;
+}
+
+// Claim one of the ring's registered buffers, or return -1 if all are in use
+static int claim_buffer(CacheRing *ring) {
+    for (int i = 0; i < CACHE_URING_BUFFERS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&ring->buffer_used[i], &expected, 1)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Give up on every write that hasn't finished, removing its temporary file
+// The kernel may still touch the ops and buffers it was given, so those are
+// never freed or reused
+static void drop_unfinished_writes(CacheRing *ring) {
+    for (CacheOp *op = ring->writes; op != NULL; op = op->next) {
+        close(op->fd);
+        unlink(op->temp_path);
+    }
+    ring->writes = NULL;
+    ring->writes_in_flight = 0;
+    ring->to_submit = 0;
+}
+
+// Wait for this thread's writes, then release its ring (runs at thread exit)
+static void destroy_ring(void *arg) {
+    CacheRing *ring = arg;
+    if (ring == &no_ring) {
+        return;
+    }
+    
+    while (ring->writes_in_flight > 0 || ring->to_submit > 0) {
+        if (submit_queued(ring, ring->in_flight > 0) != 0) {
+            drop_unfinished_writes(ring);
+            break;
+        }
+        reap_completions(ring);
+    }
+    
+    // The buffers stay allocated: a page read by this thread may still be in use
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+static void create_ring_key() {
+    pthread_key_create(&ring_key, destroy_ring);
+}
+
+// Stop using io_uring on the calling thread after io_uring_enter failed with error
+// Unfinished writes are dropped, the ring is closed and the thread uses stdio
+// from now on
+static void abandon_ring(CacheRing *ring, int error) {
+    fprintf(stderr, "Warning: io_uring_enter failed (%s), using stdio for this thread's page cache\n",
+            strerror(error));
+    
+    drop_unfinished_writes(ring);
+    pthread_setspecific(ring_key, &no_ring);
+    destroy_ring(ring);
+}
+
+// Check whether the kernel behind ring fd supports IORING_OP_RENAMEAT
+static int probe_rename(int fd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    int supported = 0;
+    if (sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+        probe->last_op >= IORING_OP_RENAMEAT) {
+        supported = (probe->ops[IORING_OP_RENAMEAT].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+    free(probe);
+    return supported;
+}
+
+// Set up a ring for the calling thread
+// Returns NULL if io_uring can't be used
+static CacheRing *setup_ring() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    
+    int fd = sys_io_uring_setup(CACHE_URING_ENTRIES, &params);
+    if (fd < 0) {
+        if (atomic_exchange(&uring_failed, 1) == 0) {
+            fprintf(stderr, "Warning: io_uring unavailable (%s), using stdio for the page cache\n",
+                    strerror(errno));
+        }
+        return NULL;
+    }
+    
+    CacheRing *ring = calloc(1, sizeof(CacheRing));
+    ring->fd = fd;
+    
+    // Map the submission and completion rings and the entries array
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+    }
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map io_uring: %s\n", strerror(errno));
+        close(fd);
+        free(ring);
+        return NULL;
+    }
+    
+    char *sq = ring->sq_map;
+    char *cq = ring->cq_map;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    
+    // Register the page buffers, so the kernel doesn't have to map them on every I/O
+    ring->buffers = malloc((size_t)CACHE_URING_BUFFERS * CACHE_URING_BUFFER_SIZE);
+    struct iovec iovecs[CACHE_URING_BUFFERS];
+    for (int i = 0; i < CACHE_URING_BUFFERS; i++) {
+        iovecs[i].iov_base = ring->buffers + (size_t)i * CACHE_URING_BUFFER_SIZE;
+        iovecs[i].iov_len = CACHE_URING_BUFFER_SIZE;
+    }
+    if (sys_io_uring_register(fd, IORING_REGISTER_BUFFERS, iovecs, CACHE_URING_BUFFERS) != 0) {
+        // Still usable, just without fixed buffers
+        free(ring->buffers);
+        ring->buffers = NULL;
+    }
+    
+    ring->can_rename = probe_rename(fd);
+    
+    int index = atomic_fetch_add(&ring_count, 1);
+    if (index >= MAX_METRIC_THREADS) {
+        // Too many threads to track their buffers; let this one use stdio
+        destroy_ring(ring);
+        free(ring->buffers);
+        free(ring);
+        return NULL;
+    }
+    atomic_store_explicit(&rings[index], ring, memory_order_release);
+    return ring;
+}
+
+// The calling thread's ring, set up on first use
+// Returns NULL if io_uring is switched off or unavailable
+static CacheRing *thread_ring() {
+    if (!cache_io_uring || atomic_load(&uring_failed)) {
+        return NULL;
+    }
+    
+    pthread_once(&ring_key_once, create_ring_key);
+    CacheRing *ring = pthread_getspecific(ring_key);
+    if (ring == NULL) {
+        ring = setup_ring();
+        pthread_setspecific(ring_key, ring ? ring : &no_ring);
+    }
+    return ring == &no_ring ? NULL : ring;
+}
+
+// Wait until no write to filename is in flight on ring (all writes if NULL)
+// Returns 0 on success, -1 if io_uring_enter failed
+static int wait_for_writes(CacheRing *ring, const char *filename) {
+    while (1) {
+        CacheOp *op = ring->writes;
+        while (op != NULL && filename != NULL && strcmp(op->final_path, filename) != 0) {
+            op = op->next;
+        }
+        if (op == NULL) {
+            return 0;
+        }
+        
+        if (submit_queued(ring, ring->in_flight > 0) != 0) {
+            return -1;
+        }
+        reap_completions(ring);
+    }
+}
+
+// Read a whole cache file with io_uring
+// Returns 1 if io_uring handled the read (*content is the page, or NULL if it
+// isn't cached), 0 if the caller should use stdio instead
+int cache_uring_read(const char *filename, char **content) {
+    CacheRing *ring = thread_ring();
+    if (ring == NULL) {
+        return 0;
+    }
+    
+    // A page this thread wrote a moment ago may not be in place yet
+    if (wait_for_writes(ring, filename) != 0) {
+        abandon_ring(ring, errno);
+        return 0;
+    }
+    
+    *content = NULL;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 1;  // Not in cache
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 1;
+    }
+    size_t size = st.st_size;
+    
+    // Small pages go into a registered buffer, others into a fresh one
+    CacheOp op;
+    memset(&op, 0, sizeof(op));
+    op.slot = (ring->buffers && size + 1 <= CACHE_URING_BUFFER_SIZE) ? claim_buffer(ring) : -1;
+    char *page = op.slot >= 0 ? ring->buffers + (size_t)op.slot * CACHE_URING_BUFFER_SIZE
+                              : malloc(size + 1);
+    
+    struct io_uring_sqe *sqe = get_sqe(ring, 1);
+    if (sqe == NULL) {
+        int error = errno;
+        close(fd);
+        free_page(page);
+        abandon_ring(ring, error);
+        return 0;
+    }
+    sqe->fd = fd;
+    sqe->off = 0;
+    sqe->user_data = (uintptr_t)&op;
+    if (op.slot >= 0) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uintptr_t)page;
+        sqe->len = size;
+        sqe->buf_index = op.slot;
+    } else {
+        op.iov.iov_base = page;
+        op.iov.iov_len = size;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uintptr_t)&op.iov;
+        sqe->len = 1;
+    }
+    queue_sqe(ring, sqe);
+    
+    // Submit the read, along with anything left over from an interrupted submit
+    while (!op.done) {
+        if (submit_queued(ring, 1) != 0) {
+            // The kernel may still fill page, so it is left alone, and the
+            // page is read again with stdio
+            abandon_ring(ring, errno);
+            close(fd);
+            return 0;
+        }
+        reap_completions(ring);
+    }
+    close(fd);
+    
+    if (op.result != (int)size) {
+        free_page(page);
+        return 1;  // Treat a short read as a cache miss
+    }
+    page[size] = '\0';
+    *content = page;
+    return 1;
+}
+
+// Write a cache file with io_uring, without waiting for the write to finish
+// The write is submitted straight away; with a linked rename the kernel puts
+// the page in place by itself, otherwise this waits for the write
+// Returns 1 if io_uring took the write, 0 if the caller should use stdio instead
+int cache_uring_write(const char *filename, const char *html) {
+    CacheRing *ring = thread_ring();
+    if (ring == NULL) {
+        return 0;
+    }
+    
+    // Collect any writes that finished since last time
+    reap_completions(ring);
+    
+    CacheOp *op = calloc(1, sizeof(CacheOp));
+    op->is_write = 1;
+    op->length = strlen(html);
+    op->linked_rename = ring->can_rename;
+    op->pending = op->linked_rename ? 2 : 1;
+    snprintf(op->final_path, sizeof(op->final_path), "%s", filename);
+    snprintf(op->temp_path, sizeof(op->temp_path), "%s.%p.tmp", filename, (void *)op);
+    op->fd = open(op->temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (op->fd < 0) {
+        free(op);
+        return 1;  // Can't cache this page, same as fopen failing
+    }
+    
+    // The caller frees html as soon as we return, so the page is copied
+    op->slot = (ring->buffers && op->length <= CACHE_URING_BUFFER_SIZE) ? claim_buffer(ring) : -1;
+    char *data = op->slot >= 0 ? ring->buffers + (size_t)op->slot * CACHE_URING_BUFFER_SIZE
+                               : (op->buffer = malloc(op->length + 1));
+    memcpy(data, html, op->length);
+    
+    ring->writes_in_flight++;
+    struct io_uring_sqe *sqe = get_sqe(ring, op->pending);
+    if (sqe == NULL) {
+        int error = errno;
+        op->result = -1;            // Drops the temporary file
+        complete_write(ring, op);
+        abandon_ring(ring, error);
+        return 0;
+    }
+    sqe->fd = op->fd;
+    sqe->off = 0;
+    sqe->user_data = (uintptr_t)op;
+    if (op->slot >= 0) {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->addr = (uintptr_t)data;
+        sqe->len = op->length;
+        sqe->buf_index = op->slot;
+    } else {
+        op->iov.iov_base = data;
+        op->iov.iov_len = op->length;
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->addr = (uintptr_t)&op->iov;
+        sqe->len = 1;
+    }
+    if (op->linked_rename) {
+        // The rename only runs if the whole page was written
+        sqe->flags |= IOSQE_IO_LINK;
+        queue_sqe(ring, sqe);
+        
+        sqe = get_sqe(ring, 1);     // Can't wait: room for both was made above
+        sqe->opcode = IORING_OP_RENAMEAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)op->temp_path;
+        sqe->len = AT_FDCWD;
+        sqe->addr2 = (uintptr_t)op->final_path;
+        sqe->user_data = (uintptr_t)op | CACHE_URING_RENAME_TAG;
+    }
+    queue_sqe(ring, sqe);
+    op->next = ring->writes;
+    ring->writes = op;
+    int linked_rename = op->linked_rename;  // op is freed once the write is reaped
+    
+    // Hand the write to the kernel now, so it lands even if this thread goes idle
+    while (ring->to_submit > 0) {
+        if (submit_queued(ring, 0) != 0) {
+            abandon_ring(ring, errno);
+            return 0;  // This page is written with stdio instead
+        }
+        reap_completions(ring);
+    }
+    
+    // Without a linked rename, nothing would move the page into place while
+    // this thread is busy elsewhere
+    if (!linked_rename && wait_for_writes(ring, filename) != 0) {
+        abandon_ring(ring, errno);
+        return 0;
+    }
+    return 1;
+}
+
+// Wait until this thread's writes are all on disk under their final names
+void cache_uring_flush() {
+    CacheRing *ring = thread_ring();
+    if (ring == NULL) {
+        return;
+    }
+    
+    if (wait_for_writes(ring, NULL) != 0) {
+        abandon_ring(ring, errno);
+    }
+}
+
+// Give back a page returned by cache_uring_read()
+// Returns 1 if it was a registered buffer, 0 if it should be freed normally
+int cache_uring_release(char *page) {
+    int count = atomic_load(&ring_count);
+    if (count > MAX_METRIC_THREADS) {
+        count = MAX_METRIC_THREADS;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        CacheRing *ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (ring == NULL || ring->buffers == NULL) {
+            continue;
+        }
+        char *end = ring->buffers + (size_t)CACHE_URING_BUFFERS * CACHE_URING_BUFFER_SIZE;
+        if (page >= ring->buffers && page < end) {
+            int slot = (int)((page - ring->buffers) / CACHE_URING_BUFFER_SIZE);
+            atomic_store(&ring->buffer_used[slot], 0);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#else
+
+// No io_uring on this platform: the page cache always uses stdio
+
+int cache_uring_read(const char *filename, char **content) {
+    (void)filename; (void)content; // Unused parameters
+    return 0;
+}
+
+int cache_uring_write(const char *filename, const char *html) {
+    (void)filename; (void)html; // Unused parameters
+    return 0;
+}
+
+void cache_uring_flush() {
+}
+
+int cache_uring_release(char *page) {
+    (void)page; // Unused parameter
+    return 0;
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "crawler.h"
+
+// ============================================================================
+// URL CANONICALIZATION AND REDIRECT ALIASES
+// ============================================================================
+
+// Many different URLs lead to the same article: "Caf%C3%A9" and "Café",
+// "linux" and "Linux", "Unix?oldid=5", and redirects like GNU/Linux -> Linux.
+// Links are canonicalized before they are checked against the visited set,
+// and redirects are remembered in an alias map that is kept in the cache
+// directory, so every later run skips them too. A redirect is seen either as
+// an HTTP 3xx while fetching (http.c) or, as Wikipedia usually serves them, as
+// a 200 whose <link rel="canonical"> names another article (parse.c).
+
+// Node in the alias hash table
+typedef struct AliasNode {
+    char *alias;                    // URL that redirects
+    char *canonical;                // Where it ends up
+    struct AliasNode *next;         // Next node in chain (for collision handling)
+} AliasNode;
+
+static AliasNode *alias_table[HASH_TABLE_SIZE];
+static pthread_rwlock_t alias_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// New aliases are appended to ALIAS_FILE through one stream, opened on first use
+// It has its own lock so lookups never wait for the disk
+static FILE *alias_file = NULL;
+static pthread_mutex_t alias_file_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Characters that may appear unencoded in a canonical title
+// Everything else (non-ASCII bytes, '%', '?', '#', quotes, ...) is written as %XX
+static int is_title_safe(unsigned char c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        return 1;
+    }
+    return strchr("-_.~!$&'()*+,;=:@/", c) != NULL && c != '\0';
+}
+
+// Value of a hex digit, or -1
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Write the canonical form of url into out
+// - scheme and host are lowercased
+// - the #fragment is dropped, and so is any ?query on /wiki/ pages
+// - the title is percent-decoded, spaces become underscores, repeated and
+//   trailing underscores are removed, and the first letter is capitalized
+//   (Wikipedia treats it as case-insensitive)
+// - the title is then re-encoded the same way every time
+void canonicalize_url(const char *url, char *out, size_t size) {
+    char result[2048];
+    size_t length = 0;
+    
+    // Scheme and host, lowercased
+    const char *path = url;
+    const char *scheme_end = strstr(url, "://");
+    if (scheme_end != NULL) {
+        path = strchr(scheme_end + 3, '/');
+        if (path == NULL) {
+            path = url + strlen(url);
+        }
+        for (const char *p = url; p < path && length < sizeof(result) - 1; p++) {
+            char c = *p;
+            result[length++] = (c >= 'A' && c <= 'Z') ? c + 32 : c;
+        }
+    }
+    
+    // Anything that isn't an article: just drop the fragment
+    if (!starts_with(path, "/wiki/")) {
+        size_t rest = strcspn(path, "#");
+        snprintf(out, size, "%.*s%.*s", (int)length, result, (int)rest, path);
+        return;
+    }
+    
+    // Decode the title (up to any ?query or #fragment)
+    const char *title = path + strlen("/wiki/");
+    size_t title_end = strcspn(title, "?#");
+    char decoded[1024];
+    size_t decoded_length = 0;
+    for (size_t i = 0; i < title_end && decoded_length < sizeof(decoded) - 1; i++) {
+        char c = title[i];
+        if (c == '%' && i + 2 < title_end &&
+            hex_value(title[i + 1]) >= 0 && hex_value(title[i + 2]) >= 0) {
+            c = (char)(hex_value(title[i + 1]) * 16 + hex_value(title[i + 2]));
+            i += 2;
+        }
+        if (c == ' ') {
+            c = '_';
+        }
+        
+        // Skip leading and repeated underscores
+        if (c == '_' && (decoded_length == 0 || decoded[decoded_length - 1] == '_')) {
+            continue;
+        }
+        decoded[decoded_length++] = c;
+    }
+    while (decoded_length > 0 && decoded[decoded_length - 1] == '_') {
+        decoded_length--;
+    }
+    if (decoded_length > 0 && decoded[0] >= 'a' && decoded[0] <= 'z') {
+        decoded[0] -= 32;
+    }
+    
+    // Re-encode the title after "/wiki/"
+    length += snprintf(result + length, sizeof(result) - length, "/wiki/");
+    for (size_t i = 0; i < decoded_length && length < sizeof(result) - 4; i++) {
+        unsigned char c = (unsigned char)decoded[i];
+        if (is_title_safe(c)) {
+            result[length++] = c;
+        } else {
+            length += snprintf(result + length, sizeof(result) - length, "%%%02X", c);
+        }
+    }
+    result[length] = '\0';
+    
+    snprintf(out, size, "%s", result);
+}
+
+// Add an alias to the table without saving it
+// Caller must hold alias_lock for writing
+// Returns 1 if the alias is new, 0 if it was already known
+static int add_alias(const char *alias, const char *canonical) {
+    unsigned int index = hash_string(alias);
+    
+    for (AliasNode *current = alias_table[index]; current != NULL; current = current->next) {
+        if (strcmp(current->alias, alias) == 0) {
+            return 0;  // Already known
+        }
+    }
+    
+    AliasNode *node = malloc(sizeof(AliasNode));
+    node->alias = strdup(alias);
+    node->canonical = strdup(canonical);
+    node->next = alias_table[index];
+    alias_table[index] = node;
+    return 1;
+}
+
+// Load the aliases saved by earlier runs (call after init_cache)
+void init_aliases() {
+    FILE *f = fopen(ALIAS_FILE, "r");
+    if (!f) {
+        return;  // No aliases yet
+    }
+    
+    char alias[1024], canonical[1024];
+    pthread_rwlock_wrlock(&alias_lock);
+    while (fscanf(f, "%1023s %1023s", alias, canonical) == 2) {
+        add_alias(alias, canonical);
+    }
+    pthread_rwlock_unlock(&alias_lock);
+    
+    fclose(f);
+}
+
+// Look up where a URL redirects to
+// Returns the canonical URL, or NULL if the URL isn't a known alias
+// The returned string is never freed, so it can be kept
+const char *resolve_alias(const char *url) {
+    unsigned int index = hash_string(url);
+    const char *canonical = NULL;
+    
+    pthread_rwlock_rdlock(&alias_lock);
+    for (AliasNode *current = alias_table[index]; current != NULL; current = current->next) {
+        if (strcmp(current->alias, url) == 0) {
+            canonical = current->canonical;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&alias_lock);
+    
+    return canonical;
+}
+
+// Map a canonical link to the URL that should be crawled for it
+// Returns the redirect target for known aliases, otherwise the link itself
+const char *resolve_link(const char *url) {
+    const char *canonical = resolve_alias(url);
+    return canonical ? canonical : url;
+}
+
+// Remember that alias is another name for canonical, and save it for later runs
+// Returns 1 if the alias is new, 0 if it was already known
+int record_alias(const char *alias, const char *canonical) {
+    if (strcmp(alias, canonical) == 0) {
+        return 0;
+    }
+    
+    pthread_rwlock_wrlock(&alias_lock);
+    int added = add_alias(alias, canonical);
+    pthread_rwlock_unlock(&alias_lock);
+    
+    if (!added) {
+        return 0;
+    }
+    
+    // Append outside alias_lock; flushed right away so a killed crawl keeps it
+    pthread_mutex_lock(&alias_file_lock);
+    if (alias_file == NULL) {
+        alias_file = fopen(ALIAS_FILE, "a");
+    }
+    if (alias_file != NULL) {
+        fprintf(alias_file, "%s %s\n", alias, canonical);
+        fflush(alias_file);
+    }
+    pthread_mutex_unlock(&alias_file_lock);
+    return 1;
+}
@@ -0,0 +1,391 @@
+#include "crawler.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+// ============================================================================
+// CHECKPOINT AND RESUME
+// ============================================================================
+
+// A checkpoint file is laid out so it can be mmap'd and read in place:
+//   CheckpointHeader
+//   CheckpointNode[node_count]    (parents always come before their children)
+//   string table                  (NUL-terminated URLs)
+//   visited URLs                  (visited_size bytes of NUL-terminated URLs)
+#define CHECKPOINT_MAGIC "WCCKPT2"
+
+// Node states stored in a checkpoint
+#define CHECKPOINT_ANCESTOR 0   // Already expanded, only kept for path reconstruction
+#define CHECKPOINT_QUEUED   1   // Waiting in the frontier (stored in queue order)
+#define CHECKPOINT_IN_FLIGHT 2  // Dequeued by a worker but not finished yet
+
+typedef struct {
+    char magic[8];
+    int max_depth;
+    int node_count;
+    int visited_count;
+    long start_url;         // String table offset of the starting URL
+    long target_url;        // String table offset of the target URL
+    long strings_size;
+    long visited_size;      // Bytes of visited URLs after the string table
+} CheckpointHeader;
+
+typedef struct {
+    int parent;             // Index of the parent node, or -1 for the start page
+    int depth;
+    int priority;
+    int state;              // One of the CHECKPOINT_* states above
+    long url;               // String table offset of the URL
+} CheckpointNode;
+
+// A growable array of pointers used while taking a snapshot
+typedef struct {
+    void **items;
+    int count;
+    int capacity;
+} PointerList;
+
+static void pointer_list_add(PointerList *list, void *item) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->items = realloc(list->items, sizeof(void *) * list->capacity);
+    }
+    list->items[list->count++] = item;
+}
+
+static char *checkpoint_start_url = NULL;    // Remembered for the checkpoint header
+static int checkpoint_epoch = 0;             // Incremented for every checkpoint taken
+
+static pthread_t checkpoint_thread;
+static pthread_mutex_t checkpoint_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t checkpoint_cond = PTHREAD_COND_INITIALIZER;
+static int checkpoint_stop = 0;
+
+// Add a node and any ancestors not yet saved in this checkpoint
+// Ancestors are added first so every parent gets a smaller index than its children
+static void collect_node(PointerList *nodes, URLQueueNode *node) {
+    URLQueueNode *chain[64];
+    int length = 0;
+    
+    // Walk up until we hit the start page or a node we already saved
+    URLQueueNode *current = node;
+    while (current != NULL && current->checkpoint_epoch != checkpoint_epoch) {
+        if (length == 64) {
+            // Unusually deep chain - save the upper part first
+            collect_node(nodes, current);
+            break;
+        }
+        chain[length++] = current;
+        current = current->parent;
+    }
+    
+    for (int i = length - 1; i >= 0; i--) {
+        chain[i]->checkpoint_epoch = checkpoint_epoch;
+        chain[i]->checkpoint_id = nodes->count;
+        pointer_list_add(nodes, chain[i]);
+    }
+}
+
+// Save the current crawl state to checkpoint_path
+// Workers are only paused while pointers to the frontier and the size of the
+// visited set are copied; URLs and queue nodes never change once created, and
+// visited URLs are only appended, so the file is written unlocked
+// Returns 0 on success, -1 on error
+int save_checkpoint() {
+    if (checkpoint_path == NULL) {
+        return -1;
+    }
+    
+    PointerList frontier = {0};
+    URLQueueNode *in_flight[NUM_THREADS];
+    
+    // Take a consistent snapshot: no worker is halfway through expanding a page
+    pthread_rwlock_wrlock(&url_queue.checkpoint_lock);
+    pthread_mutex_lock(&url_queue.lock);
+    for (URLQueueNode *node = url_queue.head; node != NULL; node = node->next) {
+        pointer_list_add(&frontier, node);
+    }
+    memcpy(in_flight, url_queue.in_flight, sizeof(in_flight));
+    pthread_mutex_unlock(&url_queue.lock);
+    
+    // The visited URLs up to this point are the first visited_size bytes of its file
+    pthread_mutex_lock(&visited_set.lock);
+    int visited_count = visited_set.count;
+    long visited_size = visited_set.strings_size;
+    pthread_mutex_unlock(&visited_set.lock);
+    pthread_rwlock_unlock(&url_queue.checkpoint_lock);
+    
+    // Collect every node needed to rebuild the frontier and its paths
+    checkpoint_epoch++;
+    PointerList nodes = {0};
+    for (int i = 0; i < frontier.count; i++) {
+        collect_node(&nodes, frontier.items[i]);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        if (in_flight[i] != NULL) {
+            collect_node(&nodes, in_flight[i]);
+        }
+    }
+    
+    // Build the fixed-size tables, assigning string table offsets as we go
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.max_depth = max_depth;
+    header.node_count = nodes.count;
+    header.visited_count = visited_count;
+    header.visited_size = visited_size;
+    
+    long offset = 0;
+    header.start_url = offset;
+    offset += strlen(checkpoint_start_url) + 1;
+    header.target_url = offset;
+    offset += strlen(target_url) + 1;
+    
+    CheckpointNode *records = malloc(sizeof(CheckpointNode) * (nodes.count + 1));
+    for (int i = 0; i < nodes.count; i++) {
+        URLQueueNode *node = nodes.items[i];
+        records[i].parent = node->parent ? node->parent->checkpoint_id : -1;
+        records[i].depth = node->depth;
+        records[i].priority = node->priority;
+        records[i].state = CHECKPOINT_ANCESTOR;
+        records[i].url = offset;
+        offset += strlen(node->url) + 1;
+    }
+    for (int i = 0; i < frontier.count; i++) {
+        records[((URLQueueNode *)frontier.items[i])->checkpoint_id].state = CHECKPOINT_QUEUED;
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        if (in_flight[i] != NULL) {
+            records[in_flight[i]->checkpoint_id].state = CHECKPOINT_IN_FLIGHT;
+        }
+    }
+    
+    header.strings_size = offset;
+    
+    // Write to a temporary file and rename it, so a crash mid-write
+    // never destroys the previous checkpoint
+    char temp_path[1024];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", checkpoint_path);
+    
+    int result = -1;
+    FILE *f = fopen(temp_path, "wb");
+    if (f) {
+        fwrite(&header, sizeof(header), 1, f);
+        fwrite(records, sizeof(CheckpointNode), nodes.count, f);
+        fwrite(checkpoint_start_url, 1, strlen(checkpoint_start_url) + 1, f);
+        fwrite(target_url, 1, strlen(target_url) + 1, f);
+        for (int i = 0; i < nodes.count; i++) {
+            const char *url = ((URLQueueNode *)nodes.items[i])->url;
+            fwrite(url, 1, strlen(url) + 1, f);
+        }
+        int copied = write_visited_urls(f, visited_size);
+        
+        if (fclose(f) == 0 && copied == 0 && rename(temp_path, checkpoint_path) == 0) {
+            result = 0;
+        }
+    }
+    
+    if (result == 0) {
+        printf("Checkpoint saved: %d queued, %d visited (%s)\n",
+               frontier.count, visited_count, checkpoint_path);
+    } else {
+        fprintf(stderr, "Error writing checkpoint %s\n", checkpoint_path);
+    }
+    
+    free(records);
+    free(frontier.items);
+    free(nodes.items);
+    return result;
+}
+
+// Check every offset and index in a checkpoint's tables before any of them is used
+// Returns 1 if the tables are consistent, 0 if the file is corrupt
+static int checkpoint_tables_valid(CheckpointHeader *header, CheckpointNode *records,
+                                   const char *strings) {
+    // Every offset must point inside the string table, which must end in a NUL
+    long strings_size = header->strings_size;
+    if (strings_size <= 0 || strings[strings_size - 1] != '\0' ||
+        header->start_url < 0 || header->start_url >= strings_size ||
+        header->target_url < 0 || header->target_url >= strings_size ||
+        header->max_depth <= 0) {
+        return 0;
+    }
+    
+    // Parents must come before their children, so they are built first
+    for (int i = 0; i < header->node_count; i++) {
+        if (records[i].url < 0 || records[i].url >= strings_size ||
+            records[i].parent < -1 || records[i].parent >= i ||
+            records[i].state < CHECKPOINT_ANCESTOR || records[i].state > CHECKPOINT_IN_FLIGHT) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Load a checkpoint into the (already initialized) queue and visited set
+// Sets target_url and max_depth, and returns the starting URL through start_url
+// Returns 0 on success, -1 on error
+int load_checkpoint(const char *path, char **start_url) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening checkpoint %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CheckpointHeader)) {
+        fprintf(stderr, "Error: %s is not a checkpoint file\n", path);
+        close(fd);
+        return -1;
+    }
+    
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping checkpoint %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    // Check the header and that the tables fit inside the file
+    CheckpointHeader *header = (CheckpointHeader *)data;
+    size_t tables_size = sizeof(CheckpointHeader)
+                       + sizeof(CheckpointNode) * (size_t)header->node_count;
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+        header->node_count < 0 || header->visited_count < 0 ||
+        header->strings_size < 0 || header->visited_size < 0 ||
+        tables_size > (size_t)st.st_size ||
+        (size_t)header->strings_size > (size_t)st.st_size - tables_size ||
+        tables_size + (size_t)header->strings_size + (size_t)header->visited_size
+            != (size_t)st.st_size ||
+        (header->visited_size > 0 && data[st.st_size - 1] != '\0')) {
+        fprintf(stderr, "Error: %s is not a valid checkpoint file\n", path);
+        munmap(data, st.st_size);
+        return -1;
+    }
+    
+    CheckpointNode *records = (CheckpointNode *)(data + sizeof(CheckpointHeader));
+    const char *strings = data + tables_size;
+    const char *visited = strings + header->strings_size;
+    
+    // Reject a corrupt or hand-edited file before building anything from it
+    if (!checkpoint_tables_valid(header, records, strings)) {
+        fprintf(stderr, "Error: %s is corrupt (bad node or string offsets)\n", path);
+        munmap(data, st.st_size);
+        return -1;
+    }
+    
+    max_depth = header->max_depth;
+    target_url = strdup(strings + header->target_url);
+    *start_url = strdup(strings + header->start_url);
+    checkpoint_start_url = *start_url;
+    
+    if (load_visited_urls(visited, header->visited_size) != 0) {
+        munmap(data, st.st_size);
+        return -1;
+    }
+    
+    // Rebuild the nodes; parents always come first, so their pointers already exist
+    URLQueueNode **nodes = malloc(sizeof(URLQueueNode *) * (header->node_count + 1));
+    for (int i = 0; i < header->node_count; i++) {
+        URLQueueNode *node = malloc(sizeof(URLQueueNode));
+        node->url = strdup(strings + records[i].url);
+        node->depth = records[i].depth;
+        node->priority = records[i].priority;
+        node->parent = records[i].parent >= 0 ? nodes[records[i].parent] : NULL;
+        node->next = NULL;
+        node->checkpoint_epoch = 0;
+        node->checkpoint_id = 0;
+        node->prefetched = 0;
+        nodes[i] = node;
+    }
+    
+    // Queued nodes were saved in queue order, so append them first;
+    // pages that were in flight go back in by priority
+    for (int i = 0; i < header->node_count; i++) {
+        if (records[i].state == CHECKPOINT_QUEUED) {
+            restore_node(nodes[i], 1);
+        }
+    }
+    for (int i = 0; i < header->node_count; i++) {
+        if (records[i].state == CHECKPOINT_IN_FLIGHT) {
+            restore_node(nodes[i], 0);
+        }
+    }
+    
+    printf("Resumed checkpoint %s: %d nodes, %d visited\n",
+           path, header->node_count, header->visited_count);
+    
+    free(nodes);
+    munmap(data, st.st_size);
+    return 0;
+}
+
+// Background thread that saves a checkpoint every checkpoint_interval seconds
+static void *checkpoint_loop(void *arg) {
+    (void)arg; // Unused parameter
+    
+    pthread_mutex_lock(&checkpoint_mutex);
+    while (!checkpoint_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += checkpoint_interval;
+        
+        // Sleep until the deadline, waking early only when asked to stop
+        int rc = 0;
+        while (!checkpoint_stop && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&checkpoint_cond, &checkpoint_mutex, &deadline);
+        }
+        if (checkpoint_stop) {
+            break;
+        }
+        
+        pthread_mutex_unlock(&checkpoint_mutex);
+        save_checkpoint();
+        pthread_mutex_lock(&checkpoint_mutex);
+    }
+    pthread_mutex_unlock(&checkpoint_mutex);
+    
+    return NULL;
+}
+
+// Start periodic checkpoints (does nothing if checkpoint_path is not set)
+// start_url is recorded in each checkpoint so --resume can report the full query
+void start_checkpointer(const char *start_url) {
+    if (checkpoint_path == NULL) {
+        return;
+    }
+    if (checkpoint_start_url == NULL) {
+        checkpoint_start_url = strdup(start_url);
+    }
+    
+    checkpoint_stop = 0;
+    if (pthread_create(&checkpoint_thread, NULL, checkpoint_loop, NULL) != 0) {
+        fprintf(stderr, "Error creating checkpoint thread\n");
+        checkpoint_path = NULL;
+    }
+}
+
+// Stop the checkpoint thread and wait for any checkpoint in progress
+// If the crawl is over (target found or nothing left to crawl), the checkpoint
+// is removed so a later --resume doesn't run a finished crawl again
+void stop_checkpointer() {
+    if (checkpoint_path == NULL) {
+        return;
+    }
+    
+    pthread_mutex_lock(&checkpoint_mutex);
+    checkpoint_stop = 1;
+    pthread_cond_signal(&checkpoint_cond);
+    pthread_mutex_unlock(&checkpoint_mutex);
+    
+    pthread_join(checkpoint_thread, NULL);
+    
+    pthread_mutex_lock(&url_queue.lock);
+    int finished = url_queue.found || url_queue.head == NULL;
+    pthread_mutex_unlock(&url_queue.lock);
+    
+    if (finished && unlink(checkpoint_path) == 0) {
+        printf("Crawl finished, removed checkpoint %s\n", checkpoint_path);
+    }
+}
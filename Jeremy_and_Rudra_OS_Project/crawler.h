@@ -12,11 +12,49 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
+#include <stdatomic.h>
 
 // Maximum number of URLs to track in hash table
 #define HASH_TABLE_SIZE 10000
 // Number of worker threads
 #define NUM_THREADS 4
+// Number of threads answering clients in server mode
+#define SERVER_THREADS 16
+// Default seconds a server query may run before giving up
+#define SERVER_QUERY_TIMEOUT 30
+// Threads fetching frontier pages ahead of batch and server queries (see graph.c)
+#define FETCH_AHEAD_THREADS 8
+// Default number of each query's best frontier pages handed to those threads
+#define QUERY_FETCH_AHEAD 4
+// Most pages waiting for a fetch-ahead thread; further requests are dropped
+#define FETCH_AHEAD_QUEUE 64
+// Milliseconds between timeout and hang-up checks while a query waits for a
+// page another thread is fetching
+#define QUERY_WAIT_CHECK_MS 100
+// Default number of seconds between crawl checkpoints
+#define CHECKPOINT_INTERVAL 60
+// Default memory for the visited set's Bloom filter, in MB
+#define VISITED_FILTER_MB 16
+// Default false positive rate the Bloom filter is tuned for
+#define VISITED_FP_RATE 0.01
+// Number of threads downloading pages ahead of the workers (see prefetch.c)
+#define PREFETCH_THREADS 2
+
+// Latency histograms use power-of-two microsecond buckets (<1us up to ~8s)
+#define METRIC_BUCKETS 24
+// Most threads that get their own metrics slot (the rest share one overflow slot)
+#define MAX_METRIC_THREADS 64
+// Timers recorded in every thread's metrics
+#define TIMER_FETCH 0           // Network fetch of a page
+#define TIMER_CACHE_READ 1      // Reading a page from the disk cache
+#define TIMER_PARSE 2           // Parsing a page for links
+#define TIMER_ENQUEUE_WAIT 3    // Waiting for the queue lock in enqueue()
+#define TIMER_VISITED_WAIT 4    // Waiting for the visited set lock
+#define NUM_TIMERS 5
+
+// Async logger buffer: number of lines and longest line
+#define LOG_QUEUE_SIZE 1024
+#define LOG_LINE_SIZE 512
 
 // Structure for a node in the URL queue
 // Each node stores a URL, its depth, priority, and a pointer to its parent (for path reconstruction)
@@ -26,6 +64,9 @@ typedef struct URLQueueNode {
     int priority;                   // Priority score (higher = more relevant)
     struct URLQueueNode *parent;    // Parent node for backtracking the path
     struct URLQueueNode *next;      // Next node in the queue
+    int checkpoint_epoch;           // Last checkpoint that saved this node (checkpoint thread only)
+    int checkpoint_id;              // Index of this node in that checkpoint
+    int prefetched;                 // 1 once a prefetch thread has claimed this page
 } URLQueueNode;
 
 // Thread-safe queue for managing URLs to be crawled
@@ -34,21 +75,44 @@ typedef struct {
     URLQueueNode *tail;             // End of queue
     pthread_mutex_t lock;           // Mutex for thread-safe access
     pthread_cond_t cond;            // Condition variable for thread coordination
-    int active_threads;             // Number of threads currently working
+    int active_threads;             // Number of threads currently expanding a page
+    int size;                       // Number of nodes waiting in the queue
     int found;                      // Flag: 1 if target URL found, 0 otherwise
     URLQueueNode *target_node;      // Pointer to the target node when found
+    URLQueueNode *in_flight[NUM_THREADS];  // Node each worker has dequeued but not finished
+    pthread_rwlock_t checkpoint_lock;      // Held for reading while a worker expands a page
 } URLQueue;
 
-// Node for the hash table (visited URLs tracking)
+// Node for a chained hash table of URLs (per-query seen sets in batch.c)
 typedef struct VisitedNode {
     char *url;                      // The URL
     struct VisitedNode *next;       // Next node in chain (for collision handling)
 } VisitedNode;
 
-// Hash table to track which URLs have been visited
+// Slot in the visited set's on-disk index (see hash.c)
+typedef struct {
+    unsigned long long hash;        // 64-bit URL hash (0 = empty slot)
+    long offset;                    // Where the URL starts in the strings file
+} VisitedSlot;
+
+// Set of URLs already visited, in two tiers:
+// a Bloom filter in memory that is checked without a lock, and an exact
+// table kept in files under CACHE_DIR that is only checked when the
+// filter says a URL may have been seen
 typedef struct {
-    VisitedNode *table[HASH_TABLE_SIZE];  // Array of linked lists
-    pthread_mutex_t lock;                  // Mutex for thread-safe access
+    _Atomic unsigned long long *filter;    // One 64-byte block (8 words) per filter_blocks
+    unsigned long filter_blocks;           // Number of blocks in the filter
+    int filter_hashes;                     // Bits set per URL
+    unsigned long filter_capacity;         // URLs the filter holds at visited_fp_rate
+    VisitedSlot *slots;                    // mmap'd open-addressing index
+    unsigned long slot_count;              // Number of slots (a power of two)
+    int index_fd;                          // File behind slots
+    int strings_fd;                        // Append-only file of NUL-terminated URLs
+    long strings_size;                     // Bytes written to strings_fd
+    unsigned long count;                   // URLs in the set
+    unsigned long exact_checks;            // Lookups the filter couldn't answer
+    unsigned long false_positives;         // ...that turned out not to be in the set
+    pthread_mutex_t lock;                  // Protects everything but the filter
 } VisitedSet;
 
 // Structure to store the HTTP response data
@@ -64,45 +128,163 @@ typedef struct {
     int capacity;       // Capacity of the array
 } URLList;
 
+// A page in the shared link graph, holding its parsed outlinks
+typedef struct PageNode {
+    char *url;                      // The page URL
+    URLList *links;                 // Outlinks (NULL until fetched)
+    int state;                      // PAGE_NEW, PAGE_FETCHING or PAGE_READY (see graph.c)
+    int fetch_requested;            // Waiting for a fetch-ahead thread
+    struct PageNode *next;          // Next node in chain (for collision handling)
+} PageNode;
+
+// Hash table of every page fetched so far, shared by all queries
+typedef struct {
+    PageNode *table[HASH_TABLE_SIZE];     // Array of linked lists
+    int page_count;                       // Number of pages fetched so far
+    pthread_mutex_t lock;                 // Mutex for thread-safe access
+    pthread_cond_t cond;                  // Signalled when a page finishes fetching
+} LinkGraph;
+
+// Latency histogram for one kind of operation
+typedef struct {
+    atomic_ulong count;                     // Number of samples
+    atomic_ullong total_ns;                 // Sum of all samples
+    atomic_ulong buckets[METRIC_BUCKETS];   // Bucket i counts samples under 2^i us
+} LatencyHistogram;
+
+// Counters and timers owned by a single thread (see metrics.c)
+// The stats thread reads them while the owner updates them, so every field is
+// atomic; update them with METRIC_ADD
+typedef struct {
+    atomic_ulong pages;             // Pages expanded
+    atomic_ulong cache_hits;        // Pages read from the disk cache
+    atomic_ulong cache_misses;      // Pages fetched from the network
+    atomic_ulong fetch_errors;      // Failed network fetches
+    atomic_ulong links_found;       // Links parsed out of pages
+    atomic_ulong prefetched;        // Pages downloaded ahead of the workers
+    LatencyHistogram timers[NUM_TIMERS];
+} ThreadMetrics;
+
+// Add amount to one of the calling thread's counters, e.g. METRIC_ADD(pages, 1)
+// Relaxed ordering is enough: readers only need each counter to be untorn
+#define METRIC_ADD(field, amount) \
+    atomic_fetch_add_explicit(&thread_metrics()->field, (amount), memory_order_relaxed)
+
+// Limits on a single path query (batch and server modes)
+typedef struct {
+    double timeout;     // Seconds before the query gives up (0 = no limit)
+    int cancel_fd;      // Client socket; the query stops if it hangs up (-1 = none)
+} QueryLimits;
+
 // Cache directory
 #define CACHE_DIR ".cache"
+// Redirects seen so far, one "alias canonical" pair per line
+#define ALIAS_FILE CACHE_DIR "/aliases.txt"
 
 // Global variables
 extern URLQueue url_queue;                 // The shared queue of URLs to process
 extern VisitedSet visited_set;             // Set of URLs already visited
 extern char *target_url;                   // The destination URL we're searching for
 extern int max_depth;                      // Maximum depth to search
+extern const char *wiki_base;              // Scheme and host that /wiki/ links are resolved against
+extern int wiki_base_from_query;           // Take wiki_base from the first batch/server query
+extern LinkGraph link_graph;               // Outlinks shared between batch queries
+extern int log_pages;                      // Print a line for every page crawled
+extern unsigned long log_lines_dropped;    // Log lines lost because the buffer was full
+extern char *checkpoint_path;              // Where to save checkpoints (NULL = disabled)
+extern int checkpoint_interval;            // Seconds between checkpoints
+extern int visited_memory_mb;              // Memory for the visited set's Bloom filter
+extern double visited_fp_rate;             // False positive rate the filter is tuned for
+extern int prefetch_budget;                // Queue or frontier entries fetched ahead (0 = off)
+extern int cache_io_uring;                 // Use io_uring for the page cache when available
 
 // Function declarations
 unsigned int hash_string(const char *str);
-void init_visited_set();
+unsigned long long hash_url(const char *url);
+int init_visited_set();
 int is_visited(const char *url);
 void mark_visited(const char *url);
+int load_visited_urls(const char *urls, long size);
+int write_visited_urls(FILE *f, long size);
 
 int calculate_priority(const char *url, const char *target);
 
 void init_queue();
 void enqueue(const char *url, int depth, URLQueueNode *parent);
-URLQueueNode *dequeue();
+void restore_node(URLQueueNode *node, int sorted);
+URLQueueNode *dequeue(int worker_id);
+void finish_node(int worker_id);
 
 void init_cache();
 void url_to_cache_filename(const char *url, char *filename, size_t size);
 char *read_from_cache(const char *url);
 void write_to_cache(const char *url, const char *html);
+void flush_cache_writes();
+void free_page(char *html);
+
+int cache_uring_read(const char *filename, char **content);
+int cache_uring_write(const char *filename, const char *html);
+void cache_uring_flush();
+int cache_uring_release(char *page);
 
+char *download_url(const char *url, atomic_int *cancel);
 char *fetch_url(const char *url);
 
+void canonicalize_url(const char *url, char *out, size_t size);
+void init_aliases();
+const char *resolve_alias(const char *url);
+const char *resolve_link(const char *url);
+int record_alias(const char *alias, const char *canonical);
+
 URLList *create_url_list();
 void add_url_to_list(URLList *list, const char *url);
+void set_wiki_base_from_url(const char *url);
 int starts_with(const char *str, const char *prefix);
 int is_blacklisted(const char *url);
 int is_valid_wiki_link(const char *href);
-void search_for_links(GumboNode *node, URLList *list);
-URLList *parse_html(const char *html);
+void search_for_links(GumboNode *node, URLList *list, const char **canonical_href);
+URLList *parse_html(const char *url, const char *html);
 void free_url_list(URLList *list);
 
 void print_path(URLQueueNode *target_node);
 
 void *crawl_worker(void *arg);
 
+void init_link_graph();
+URLList *get_outlinks(const char *url, double deadline, int cancel_fd);
+void request_outlinks(const char *url);
+void start_fetch_ahead();
+void stop_fetch_ahead();
+
+const char *query_stop_reason(double deadline, int cancel_fd);
+void run_query(FILE *out, long line, const char *start, const char *target, int depth,
+               QueryLimits *limits);
+void handle_query_line(FILE *out, char *line, long line_number, QueryLimits *limits);
+int run_batch(const char *path);
+
+int run_server(const char *socket_path);
+
+long long now_ns();
+double monotonic_seconds();
+ThreadMetrics *thread_metrics();
+void record_timer(int timer, long long start_ns);
+void collect_metrics(ThreadMetrics *total);
+int write_metrics(const char *path);
+void start_stats(int interval, const char *metrics_path);
+void stop_stats();
+
+void log_message(const char *format, ...);
+void start_logger();
+void stop_logger();
+
+void start_prefetcher();
+void cancel_prefetch();
+void stop_prefetcher();
+void wait_for_prefetch(const char *url);
+
+int save_checkpoint();
+int load_checkpoint(const char *path, char **start_url);
+void start_checkpointer(const char *start_url);
+void stop_checkpointer();
+
 #endif
\ No newline at end of file
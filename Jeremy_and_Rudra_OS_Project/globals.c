@@ -0,0 +1,20 @@
+#include "crawler.h"
+
+// ============================================================================
+// GLOBAL VARIABLES (shared by the crawler and the benchmarks)
+// ============================================================================
+
+URLQueue url_queue;                 // The shared queue of URLs to process
+VisitedSet visited_set;             // Set of URLs already visited
+LinkGraph link_graph;               // Outlinks shared between batch queries
+char *target_url;                   // The destination URL we're searching for
+int max_depth;                      // Maximum depth to search
+const char *wiki_base = "https://en.wikipedia.org";  // Where /wiki/ links point
+int wiki_base_from_query = 0;       // Take wiki_base from the first batch/server query
+char *checkpoint_path = NULL;       // Where to save checkpoints (NULL = disabled)
+int checkpoint_interval = CHECKPOINT_INTERVAL;  // Seconds between checkpoints
+int log_pages = 1;                  // Print a line for every page crawled
+int visited_memory_mb = VISITED_FILTER_MB;   // Memory for the visited set's Bloom filter
+double visited_fp_rate = VISITED_FP_RATE;    // False positive rate the filter is tuned for
+int prefetch_budget = 0;            // Queue or frontier entries fetched ahead (0 = off)
+int cache_io_uring = 1;             // Use io_uring for the page cache when available
@@ -0,0 +1,202 @@
+#include "crawler.h"
+
+// ============================================================================
+// LINK GRAPH (outlinks shared between queries)
+// ============================================================================
+
+// Page states in the link graph
+#define PAGE_NEW      0   // Not fetched yet (or the last fetch failed)
+#define PAGE_FETCHING 1   // A thread is fetching and parsing it right now
+#define PAGE_READY    2   // Outlinks are available
+
+// Pages queries have asked the fetch-ahead threads to fetch (protected by
+// link_graph.lock); a ring of FETCH_AHEAD_QUEUE entries
+static PageNode *fetch_requests[FETCH_AHEAD_QUEUE];
+static int fetch_request_first = 0;
+static int fetch_request_count = 0;
+static pthread_cond_t fetch_request_cond = PTHREAD_COND_INITIALIZER;
+static int fetch_ahead_stop = 0;
+static pthread_t fetch_ahead_threads[FETCH_AHEAD_THREADS];
+static int fetch_ahead_running = 0;
+
+// Initialize the link graph
+void init_link_graph() {
+    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
+        link_graph.table[i] = NULL;
+    }
+    link_graph.page_count = 0;
+    pthread_mutex_init(&link_graph.lock, NULL);
+    
+    // Waits are timed against query deadlines, which use the monotonic clock
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&link_graph.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+}
+
+// Find a page in the graph, adding an empty entry if it's not there
+// Caller must hold link_graph.lock
+static PageNode *find_or_add_page(const char *url) {
+    unsigned int index = hash_string(url);
+    
+    PageNode *current = link_graph.table[index];
+    while (current != NULL) {
+        if (strcmp(current->url, url) == 0) {
+            return current;
+        }
+        current = current->next;
+    }
+    
+    PageNode *page = malloc(sizeof(PageNode));
+    page->url = strdup(url);
+    page->links = NULL;
+    page->state = PAGE_NEW;
+    page->fetch_requested = 0;
+    page->next = link_graph.table[index];
+    link_graph.table[index] = page;
+    return page;
+}
+
+// Get the outlinks of a page, fetching and parsing it only the first time
+// If another thread is already fetching the page, wait for its result instead,
+// but stop waiting once query_stop_reason(deadline, cancel_fd) says to give up
+// (deadline 0 and cancel_fd -1 wait as long as it takes)
+// Returns NULL if the page could not be fetched or the wait was given up
+// The returned list belongs to the graph and must not be freed
+URLList *get_outlinks(const char *url, double deadline, int cancel_fd) {
+    pthread_mutex_lock(&link_graph.lock);
+    
+    PageNode *page = find_or_add_page(url);
+    
+    // Someone else is fetching it - wait for them, waking up now and then to
+    // notice a deadline or a client that hung up
+    while (page->state == PAGE_FETCHING) {
+        if (query_stop_reason(deadline, cancel_fd) != NULL) {
+            pthread_mutex_unlock(&link_graph.lock);
+            return NULL;
+        }
+        
+        double wake = monotonic_seconds() + QUERY_WAIT_CHECK_MS / 1000.0;
+        if (deadline > 0 && deadline < wake) {
+            wake = deadline;
+        }
+        struct timespec wake_time;
+        wake_time.tv_sec = (time_t)wake;
+        wake_time.tv_nsec = (long)((wake - wake_time.tv_sec) * 1e9);
+        pthread_cond_timedwait(&link_graph.cond, &link_graph.lock, &wake_time);
+    }
+    
+    if (page->state == PAGE_READY) {
+        pthread_mutex_unlock(&link_graph.lock);
+        return page->links;
+    }
+    
+    // We're the first to need it - fetch without holding the lock
+    page->state = PAGE_FETCHING;
+    pthread_mutex_unlock(&link_graph.lock);
+    
+    URLList *links = NULL;
+    char *html = fetch_url(url);
+    if (html != NULL) {
+        links = parse_html(url, html);
+        free_page(html);
+    }
+    
+    pthread_mutex_lock(&link_graph.lock);
+    page->links = links;
+    page->state = links ? PAGE_READY : PAGE_NEW;  // Failed pages are retried later
+    if (links != NULL) {
+        link_graph.page_count++;
+    }
+    pthread_cond_broadcast(&link_graph.cond);
+    pthread_mutex_unlock(&link_graph.lock);
+    
+    return links;
+}
+
+// Ask the fetch-ahead threads to fetch a page a query expects to expand soon,
+// so its outlinks are ready (or on their way) when the query gets to it
+// Does nothing if the page is already fetched, being fetched or requested, or
+// if the request queue is full
+void request_outlinks(const char *url) {
+    if (fetch_ahead_running == 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&link_graph.lock);
+    PageNode *page = find_or_add_page(url);
+    if (page->state == PAGE_NEW && !page->fetch_requested &&
+        fetch_request_count < FETCH_AHEAD_QUEUE) {
+        int slot = (fetch_request_first + fetch_request_count) % FETCH_AHEAD_QUEUE;
+        fetch_requests[slot] = page;
+        fetch_request_count++;
+        page->fetch_requested = 1;
+        pthread_cond_signal(&fetch_request_cond);
+    }
+    pthread_mutex_unlock(&link_graph.lock);
+}
+
+// Fetch-ahead thread: fetch requested pages into the graph until stopped
+static void *fetch_ahead_loop(void *arg) {
+    (void)arg; // Unused parameter
+    
+    pthread_mutex_lock(&link_graph.lock);
+    while (1) {
+        while (fetch_request_count == 0 && !fetch_ahead_stop) {
+            pthread_cond_wait(&fetch_request_cond, &link_graph.lock);
+        }
+        if (fetch_ahead_stop) {
+            break;
+        }
+        
+        PageNode *page = fetch_requests[fetch_request_first];
+        fetch_request_first = (fetch_request_first + 1) % FETCH_AHEAD_QUEUE;
+        fetch_request_count--;
+        page->fetch_requested = 0;
+        pthread_mutex_unlock(&link_graph.lock);
+        
+        // A query that got there first is already fetching it, or has it
+        get_outlinks(page->url, 0, -1);
+        
+        pthread_mutex_lock(&link_graph.lock);
+    }
+    pthread_mutex_unlock(&link_graph.lock);
+    
+    return NULL;
+}
+
+// Start the fetch-ahead threads (does nothing if prefetch_budget is 0)
+void start_fetch_ahead() {
+    if (prefetch_budget <= 0) {
+        return;
+    }
+    
+    fetch_ahead_stop = 0;
+    for (int i = 0; i < FETCH_AHEAD_THREADS; i++) {
+        if (pthread_create(&fetch_ahead_threads[i], NULL, fetch_ahead_loop, NULL) != 0) {
+            fprintf(stderr, "Error creating fetch-ahead thread %d\n", i);
+            break;
+        }
+        fetch_ahead_running++;
+    }
+}
+
+// Drop any pending requests and wait for the fetch-ahead threads to exit
+// A fetch in progress is allowed to finish
+void stop_fetch_ahead() {
+    pthread_mutex_lock(&link_graph.lock);
+    fetch_ahead_stop = 1;
+    while (fetch_request_count > 0) {
+        fetch_requests[fetch_request_first]->fetch_requested = 0;
+        fetch_request_first = (fetch_request_first + 1) % FETCH_AHEAD_QUEUE;
+        fetch_request_count--;
+    }
+    pthread_cond_broadcast(&fetch_request_cond);
+    pthread_mutex_unlock(&link_graph.lock);
+    
+    for (int i = 0; i < fetch_ahead_running; i++) {
+        pthread_join(fetch_ahead_threads[i], NULL);
+    }
+    fetch_ahead_running = 0;
+}
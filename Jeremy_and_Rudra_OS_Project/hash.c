@@ -1,9 +1,27 @@
 #include "crawler.h"
+#include <errno.h>
+#include <sys/mman.h>
 
 // ============================================================================
 // HASH TABLE FUNCTIONS (for tracking visited URLs)
 // ============================================================================
 
+// The visited set has two tiers so it scales to tens of millions of URLs:
+// 1. A blocked Bloom filter in memory. Every bit for a URL lives in one
+//    64-byte block, so a check touches a single cache line, and bits are only
+//    ever set, so it is read and written with atomics instead of a lock.
+//    Most new links are answered "never seen" here.
+// 2. An exact set on disk: an append-only file of URLs plus an mmap'd
+//    open-addressing index of (hash, file offset) slots. It is only consulted
+//    (under the lock) when the filter says "maybe seen", and its pages belong
+//    to the kernel's page cache rather than the heap.
+
+// Number of index slots to start with (grows by doubling)
+#define VISITED_INITIAL_SLOTS (1UL << 16)
+// URLs load_visited_urls hashes ahead, so their index slots and filter blocks
+// are already being fetched from memory by the time they are inserted
+#define VISITED_LOAD_AHEAD 16
+
 // Simple hash function for strings
 // Returns a hash value between 0 and HASH_TABLE_SIZE-1
 unsigned int hash_string(const char *str) {
@@ -18,50 +36,397 @@ unsigned int hash_string(const char *str) {
     return hash % HASH_TABLE_SIZE;
 }
 
+// 64-bit FNV-1a hash of a URL, used by both tiers and to name cache files
+// Never returns 0, which marks an empty index slot
+unsigned long long hash_url(const char *url) {
+    unsigned long long hash = 14695981039346656037ULL;
+    while (*url) {
+        hash ^= (unsigned char)*url++;
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+// Find the filter block for a hash
+static _Atomic unsigned long long *filter_block(unsigned long long hash) {
+    return visited_set.filter + (hash % visited_set.filter_blocks) * 8;
+}
+
+// Pick the next of a URL's bits inside its block
+// state starts as the URL's hash and is stepped like a linear congruential
+// generator; each bit comes from the top 9 bits, which depend on every bit of
+// the hash rather than on the low bits that chose the block
+static unsigned int filter_next_bit(unsigned long long *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(*state >> 55);
+}
+
+// Check the filter: returns 0 if the URL was definitely never added
+static int filter_check(unsigned long long hash) {
+    _Atomic unsigned long long *block = filter_block(hash);
+    unsigned long long state = hash;
+    
+    for (int i = 0; i < visited_set.filter_hashes; i++) {
+        unsigned int bit = filter_next_bit(&state);
+        unsigned long long word = atomic_load_explicit(&block[bit >> 6], memory_order_acquire);
+        if (!(word & (1ULL << (bit & 63)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Set a URL's bits in the filter
+static void filter_add(unsigned long long hash) {
+    _Atomic unsigned long long *block = filter_block(hash);
+    unsigned long long state = hash;
+    
+    for (int i = 0; i < visited_set.filter_hashes; i++) {
+        unsigned int bit = filter_next_bit(&state);
+        atomic_fetch_or_explicit(&block[bit >> 6], 1ULL << (bit & 63), memory_order_release);
+    }
+}
+
+// Expected false positive rate of the filter when blocks hold load URLs on average
+// Block loads vary (they are Poisson distributed), and fuller blocks answer
+// "maybe" much more often, so this is higher than the plain Bloom filter formula
+static double filter_fp_rate(double load) {
+    double total = 0, weighted = 0;
+    double weight = 1;  // Poisson weight of j URLs in a block, up to a constant
+    
+    for (int j = 0; j < 2048; j++) {
+        if (j > 0) {
+            weight *= load / j;
+        }
+        
+        // Chance that one bit is still clear after j URLs set theirs,
+        // then the chance that all of a new URL's bits are set
+        double clear = 1;
+        for (int i = 0; i < j * visited_set.filter_hashes; i++) {
+            clear *= 1 - 1.0 / 512;
+        }
+        double fp = 1;
+        for (int i = 0; i < visited_set.filter_hashes; i++) {
+            fp *= 1 - clear;
+        }
+        
+        total += weight;
+        weighted += weight * fp;
+        if (j > load && weight < total * 1e-12) {
+            break;  // The rest of the distribution is negligible
+        }
+    }
+    return weighted / total;
+}
+
+// Create a scratch file in the cache directory
+// It is unlinked straight away, so it disappears when the crawler exits
+// Returns the file descriptor, or -1 on error
+static int create_scratch_file() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/visited-XXXXXX", CACHE_DIR);
+    
+    mkdir(CACHE_DIR, 0755);  // Create if doesn't exist
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    unlink(path);
+    return fd;
+}
+
+// Create an index file with the given number of empty slots and map it
+// Returns the mapping (and the file through fd), or NULL on error
+static VisitedSlot *create_index(unsigned long slot_count, int *fd) {
+    *fd = create_scratch_file();
+    if (*fd < 0) {
+        return NULL;
+    }
+    
+    size_t size = sizeof(VisitedSlot) * slot_count;
+    if (ftruncate(*fd, size) != 0) {
+        fprintf(stderr, "Error: Cannot grow visited index: %s\n", strerror(errno));
+        close(*fd);
+        return NULL;
+    }
+    
+    VisitedSlot *slots = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (slots == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map visited index: %s\n", strerror(errno));
+        close(*fd);
+        return NULL;
+    }
+    return slots;
+}
+
 // Initialize the visited set
-// Sets all table entries to NULL and initializes the mutex
-void init_visited_set() {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        visited_set.table[i] = NULL;
+// The filter gets visited_memory_mb of memory and sets enough bits per URL
+// for visited_fp_rate; its capacity is the number of URLs it holds before the
+// rate climbs past that, e.g. about 13.5 million for 16 MB at 1%
+// mark_visited warns once the set grows past that capacity
+// Returns 0 on success, -1 on error
+int init_visited_set() {
+    visited_set.filter_blocks = (unsigned long)visited_memory_mb * 1024 * 1024 / 64;
+    if (visited_set.filter_blocks == 0) {
+        visited_set.filter_blocks = 1;
     }
+    visited_set.filter = calloc(visited_set.filter_blocks * 8, sizeof(unsigned long long));
+    
+    // One bit per halving of the false positive rate
+    visited_set.filter_hashes = 1;
+    for (double rate = 0.5; rate > visited_fp_rate && visited_set.filter_hashes < 16; rate /= 2) {
+        visited_set.filter_hashes++;
+    }
+    
+    // Find the largest average block load that still meets the rate
+    double low = 0, high = 512;
+    for (int i = 0; i < 40; i++) {
+        double load = (low + high) / 2;
+        if (filter_fp_rate(load) <= visited_fp_rate) {
+            low = load;
+        } else {
+            high = load;
+        }
+    }
+    visited_set.filter_capacity = (unsigned long)(low * visited_set.filter_blocks);
+    
+    visited_set.slot_count = VISITED_INITIAL_SLOTS;
+    visited_set.slots = create_index(visited_set.slot_count, &visited_set.index_fd);
+    visited_set.strings_fd = create_scratch_file();
+    visited_set.strings_size = 0;
+    visited_set.count = 0;
+    visited_set.exact_checks = 0;
+    visited_set.false_positives = 0;
     pthread_mutex_init(&visited_set.lock, NULL);
+    
+    if (visited_set.filter == NULL || visited_set.slots == NULL || visited_set.strings_fd < 0) {
+        fprintf(stderr, "Error: Cannot set up the visited set\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Check whether the URL stored at offset in the strings file is url
+static int stored_url_equals(long offset, const char *url) {
+    size_t length = strlen(url) + 1;
+    char buffer[2048];
+    char *stored = length <= sizeof(buffer) ? buffer : malloc(length);
+    
+    int equal = pread(visited_set.strings_fd, stored, length, offset) == (ssize_t)length &&
+                memcmp(stored, url, length) == 0;
+    
+    if (stored != buffer) {
+        free(stored);
+    }
+    return equal;
+}
+
+// Find the index slot holding url, or the empty slot where it would go
+// Caller must hold visited_set.lock
+static VisitedSlot *find_slot(unsigned long long hash, const char *url) {
+    unsigned long mask = visited_set.slot_count - 1;
+    
+    // Linear probing
+    for (unsigned long i = hash & mask; ; i = (i + 1) & mask) {
+        VisitedSlot *slot = &visited_set.slots[i];
+        if (slot->hash == 0) {
+            return slot;
+        }
+        if (slot->hash == hash && stored_url_equals(slot->offset, url)) {
+            return slot;
+        }
+    }
+}
+
+// Move the index to new_count slots (a larger power of two)
+// mark_visited doubles it once it is three quarters full
+// Caller must hold visited_set.lock
+static void grow_index(unsigned long new_count) {
+    int new_fd;
+    VisitedSlot *new_slots = create_index(new_count, &new_fd);
+    if (new_slots == NULL) {
+        return;  // Keep using the fuller index
+    }
+    
+    // Hashes are stored, so slots move without rereading any URLs
+    for (unsigned long i = 0; i < visited_set.slot_count; i++) {
+        VisitedSlot *slot = &visited_set.slots[i];
+        if (slot->hash == 0) {
+            continue;
+        }
+        unsigned long j = slot->hash & (new_count - 1);
+        while (new_slots[j].hash != 0) {
+            j = (j + 1) & (new_count - 1);
+        }
+        new_slots[j] = *slot;
+    }
+    
+    munmap(visited_set.slots, sizeof(VisitedSlot) * visited_set.slot_count);
+    close(visited_set.index_fd);
+    visited_set.slots = new_slots;
+    visited_set.slot_count = new_count;
+    visited_set.index_fd = new_fd;
+}
+
+// Warn that the visited set has grown past the filter's capacity
+static void warn_filter_full() {
+    fprintf(stderr, "Warning: Visited set has passed %lu URLs, the most a %d MB filter "
+            "holds at a %g false positive rate; use --visited-memory to give it more\n",
+            visited_set.filter_capacity, visited_memory_mb, visited_fp_rate);
 }
 
 // Check if a URL has been visited
 // Returns 1 if visited, 0 if not visited
 int is_visited(const char *url) {
-    unsigned int index = hash_string(url);
+    unsigned long long hash = hash_url(url);
     
+    // Most links have never been seen, and the filter answers that without a lock
+    if (!filter_check(hash)) {
+        return 0;
+    }
+    
+    long long wait_start = now_ns();
     pthread_mutex_lock(&visited_set.lock);
+    record_timer(TIMER_VISITED_WAIT, wait_start);
     
-    // Walk through the chain at this hash index
-    VisitedNode *current = visited_set.table[index];
-    while (current != NULL) {
-        if (strcmp(current->url, url) == 0) {
-            pthread_mutex_unlock(&visited_set.lock);
-            return 1; // Found it - already visited
-        }
-        current = current->next;
+    visited_set.exact_checks++;
+    int found = find_slot(hash, url)->hash != 0;
+    if (!found) {
+        visited_set.false_positives++;
     }
     
     pthread_mutex_unlock(&visited_set.lock);
-    return 0; // Not found - not visited yet
+    return found;
 }
 
 // Mark a URL as visited
-// Adds the URL to the hash table
+// Adds the URL to the exact set, then to the filter
 void mark_visited(const char *url) {
-    unsigned int index = hash_string(url);
+    unsigned long long hash = hash_url(url);
+    size_t length = strlen(url) + 1;
+    
+    long long wait_start = now_ns();
+    pthread_mutex_lock(&visited_set.lock);
+    record_timer(TIMER_VISITED_WAIT, wait_start);
+    
+    VisitedSlot *slot = find_slot(hash, url);
+    if (slot->hash == 0) {
+        if (pwrite(visited_set.strings_fd, url, length, visited_set.strings_size) != (ssize_t)length) {
+            fprintf(stderr, "Error: Cannot save visited URL: %s\n", strerror(errno));
+            pthread_mutex_unlock(&visited_set.lock);
+            return;
+        }
+        slot->hash = hash;
+        slot->offset = visited_set.strings_size;
+        visited_set.strings_size += length;
+        visited_set.count++;
+        
+        // Past its capacity the filter's false positive rate climbs quickly
+        if (visited_set.count == visited_set.filter_capacity + 1) {
+            warn_filter_full();
+        }
+        
+        if (visited_set.count * 4 >= visited_set.slot_count * 3) {
+            grow_index(visited_set.slot_count * 2);
+        }
+    }
     
+    pthread_mutex_unlock(&visited_set.lock);
+    
+    // Set the filter bits last, so a "maybe seen" always finds the URL in the exact set
+    filter_add(hash);
+}
+
+// Add a block of NUL-terminated URLs (as written by write_visited_urls) to the
+// visited set in one go, for resuming from a checkpoint
+// The block is appended to the strings file with one write and the index and
+// filter are filled under a single lock, instead of one mark_visited() per URL
+// Returns 0 on success, -1 on error
+int load_visited_urls(const char *urls, long size) {
     pthread_mutex_lock(&visited_set.lock);
     
-    // Create a new node for this URL
-    VisitedNode *new_node = malloc(sizeof(VisitedNode));
-    new_node->url = strdup(url);
+    long base = visited_set.strings_size;
+    for (long written = 0; written < size; ) {
+        ssize_t n = pwrite(visited_set.strings_fd, urls + written, size - written, base + written);
+        if (n <= 0) {
+            fprintf(stderr, "Error: Cannot save visited URLs: %s\n", strerror(errno));
+            pthread_mutex_unlock(&visited_set.lock);
+            return -1;
+        }
+        written += n;
+    }
+    visited_set.strings_size += size;
     
-    // Insert at the beginning of the chain
-    new_node->next = visited_set.table[index];
-    visited_set.table[index] = new_node;
+    // Size the index for the whole block up front rather than doubling it
+    // over and over while filling it
+    unsigned long block_count = 0;
+    for (long offset = 0; offset < size; offset++) {
+        block_count += urls[offset] == '\0';
+    }
+    unsigned long slot_count = visited_set.slot_count;
+    while ((visited_set.count + block_count) * 4 >= slot_count * 3) {
+        slot_count *= 2;
+    }
+    if (slot_count > visited_set.slot_count) {
+        grow_index(slot_count);
+    }
+    
+    // Inserting is bound by cache misses in the index and the filter, so hash
+    // a few URLs ahead and prefetch where they will go
+    unsigned long long ahead_hash[VISITED_LOAD_AHEAD];
+    long ahead_offset[VISITED_LOAD_AHEAD];
+    int ahead_count = 0, ahead_first = 0;
+    long next = 0;
+    
+    while (next < size || ahead_count > 0) {
+        while (next < size && ahead_count < VISITED_LOAD_AHEAD) {
+            int i = (ahead_first + ahead_count) % VISITED_LOAD_AHEAD;
+            ahead_hash[i] = hash_url(urls + next);
+            ahead_offset[i] = next;
+            __builtin_prefetch(&visited_set.slots[ahead_hash[i] & (visited_set.slot_count - 1)], 1);
+            __builtin_prefetch(filter_block(ahead_hash[i]), 1);
+            next += strlen(urls + next) + 1;
+            ahead_count++;
+        }
+        
+        unsigned long long hash = ahead_hash[ahead_first];
+        long offset = ahead_offset[ahead_first];
+        ahead_first = (ahead_first + 1) % VISITED_LOAD_AHEAD;
+        ahead_count--;
+        
+        // The block was just written, so a duplicate is found like any other URL
+        VisitedSlot *slot = find_slot(hash, urls + offset);
+        if (slot->hash == 0) {
+            slot->hash = hash;
+            slot->offset = base + offset;
+            visited_set.count++;
+        }
+        filter_add(hash);
+    }
+    
+    if (visited_set.count > visited_set.filter_capacity) {
+        warn_filter_full();
+    }
     
     pthread_mutex_unlock(&visited_set.lock);
+    return 0;
+}
+
+// Copy the first size bytes of the visited URLs (NUL-terminated, in the order
+// they were added) to f
+// URLs are only ever appended, so this needs no lock
+// Returns 0 on success, -1 on error
+int write_visited_urls(FILE *f, long size) {
+    char buffer[65536];
+    
+    for (long offset = 0; offset < size; ) {
+        size_t chunk = size - offset < (long)sizeof(buffer) ? (size_t)(size - offset) : sizeof(buffer);
+        ssize_t got = pread(visited_set.strings_fd, buffer, chunk, offset);
+        if (got <= 0 || fwrite(buffer, 1, got, f) != (size_t)got) {
+            return -1;
+        }
+        offset += got;
+    }
+    return 0;
 }
@@ -26,16 +26,19 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return real_size;
 }
 
-// Fetch the HTML content of a URL (with caching)
+// Progress callback for libcurl: a nonzero return aborts the transfer
+// clientp points to the cancel flag passed to download_url()
+static int cancel_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                           curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow; // Unused parameters
+    return atomic_load((atomic_int *)clientp) != 0;
+}
+
+// Fetch the HTML content of a URL from the network and save it to the cache
+// If cancel is not NULL, the transfer is abandoned as soon as *cancel is set
 // Returns the HTML as a string, or NULL on error
-char *fetch_url(const char *url) {
-    // Try to read from cache first
-    char *cached = read_from_cache(url);
-    if (cached != NULL) {
-        return cached;  // Cache hit!
-    }
-    
-    // Not in cache - fetch from network
+char *download_url(const char *url, atomic_int *cancel) {
+    long long start;
     CURL *curl;
     CURLcode res;
     HttpResponse response;
@@ -59,18 +62,43 @@ char *fetch_url(const char *url) {
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0 (compatible; WikiCrawler/1.0)");
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L); // Follow redirects
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);       // 10 second timeout
+    if (cancel != NULL) {
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancel_callback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *)cancel);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
     
     // Perform the request
+    start = now_ns();
     res = curl_easy_perform(curl);
+    record_timer(TIMER_FETCH, start);
     
     // Check for errors
     if (res != CURLE_OK) {
-        fprintf(stderr, "Error fetching %s: %s\n", url, curl_easy_strerror(res));
+        if (res != CURLE_ABORTED_BY_CALLBACK) {
+            fprintf(stderr, "Error fetching %s: %s\n", url, curl_easy_strerror(res));
+            METRIC_ADD(fetch_errors, 1);
+        }
         curl_easy_cleanup(curl);
         free(response.data);
         return NULL;
     }
     
+    // Remember where HTTP redirects ended up, so links to the same article
+    // under another name are recognized without fetching them again
+    // (redirects Wikipedia answers with a 200 are caught by parse_html)
+    long redirects = 0;
+    char *effective = NULL;
+    curl_easy_getinfo(curl, CURLINFO_REDIRECT_COUNT, &redirects);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective);
+    if (redirects > 0 && effective != NULL) {
+        char canonical[2048];
+        canonicalize_url(effective, canonical, sizeof(canonical));
+        if (record_alias(url, canonical)) {
+            write_to_cache(canonical, response.data);
+        }
+    }
+    
     curl_easy_cleanup(curl);
     
     // Save to cache for future use
@@ -78,3 +106,20 @@ char *fetch_url(const char *url) {
     
     return response.data;
 }
+
+// Fetch the HTML content of a URL (with caching)
+// Returns the HTML as a string, or NULL on error
+char *fetch_url(const char *url) {
+    // Try to read from cache first
+    long long start = now_ns();
+    char *cached = read_from_cache(url);
+    if (cached != NULL) {
+        record_timer(TIMER_CACHE_READ, start);
+        METRIC_ADD(cache_hits, 1);
+        return cached;  // Cache hit!
+    }
+    METRIC_ADD(cache_misses, 1);
+    
+    // Not in cache - fetch from network
+    return download_url(url, NULL);
+}
@@ -0,0 +1,105 @@
+#include "crawler.h"
+#include <stdarg.h>
+
+// ============================================================================
+// ASYNC LOGGER (keeps progress output off the worker threads)
+// ============================================================================
+
+// Workers format a line and drop it into a ring buffer; a logger thread does
+// the actual writing. If the buffer is full the line is dropped and counted,
+// so a slow terminal can never hold up the crawl.
+static char log_lines[LOG_QUEUE_SIZE][LOG_LINE_SIZE];
+static int log_head = 0;            // Next line to write out
+static int log_count = 0;           // Lines waiting in the buffer
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t log_thread;
+static int log_running = 0;
+static int log_stop = 0;
+
+unsigned long log_lines_dropped = 0;
+
+// Queue a printf-style line for stdout
+// Writes directly if the logger thread isn't running
+void log_message(const char *format, ...) {
+    char line[LOG_LINE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    
+    if (!log_running) {
+        fputs(line, stdout);
+        return;
+    }
+    
+    pthread_mutex_lock(&log_lock);
+    if (log_count == LOG_QUEUE_SIZE) {
+        log_lines_dropped++;
+    } else {
+        int slot = (log_head + log_count) % LOG_QUEUE_SIZE;
+        memcpy(log_lines[slot], line, sizeof(line));
+        log_count++;
+        pthread_cond_signal(&log_cond);
+    }
+    pthread_mutex_unlock(&log_lock);
+}
+
+// Logger thread - writes queued lines until stopped and the buffer is empty
+static void *log_loop(void *arg) {
+    (void)arg; // Unused parameter
+    
+    char line[LOG_LINE_SIZE];
+    
+    pthread_mutex_lock(&log_lock);
+    while (1) {
+        while (log_count == 0 && !log_stop) {
+            pthread_cond_wait(&log_cond, &log_lock);
+        }
+        if (log_count == 0) {
+            break;  // Stopped and fully drained
+        }
+        
+        // Copy the line out so the write happens without the lock
+        memcpy(line, log_lines[log_head], sizeof(line));
+        log_head = (log_head + 1) % LOG_QUEUE_SIZE;
+        log_count--;
+        
+        pthread_mutex_unlock(&log_lock);
+        fputs(line, stdout);
+        pthread_mutex_lock(&log_lock);
+    }
+    pthread_mutex_unlock(&log_lock);
+    
+    fflush(stdout);
+    return NULL;
+}
+
+// Start the logger thread
+void start_logger() {
+    log_stop = 0;
+    if (pthread_create(&log_thread, NULL, log_loop, NULL) != 0) {
+        fprintf(stderr, "Error creating logger thread\n");
+        return;
+    }
+    log_running = 1;
+}
+
+// Write out everything still queued and stop the logger thread
+void stop_logger() {
+    if (!log_running) {
+        return;
+    }
+    
+    pthread_mutex_lock(&log_lock);
+    log_stop = 1;
+    pthread_cond_signal(&log_cond);
+    pthread_mutex_unlock(&log_lock);
+    
+    pthread_join(log_thread, NULL);
+    log_running = 0;
+    
+    if (log_lines_dropped > 0) {
+        fprintf(stderr, "Logger dropped %lu lines\n", log_lines_dropped);
+    }
+}
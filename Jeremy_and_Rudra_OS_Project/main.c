@@ -1,11 +1,5 @@
 #include "crawler.h"
 
-// Global variables
-URLQueue url_queue;                 // The shared queue of URLs to process
-VisitedSet visited_set;             // Set of URLs already visited
-char *target_url;                   // The destination URL we're searching for
-int max_depth;                      // Maximum depth to search
-
 // ============================================================================
 // MAIN FUNCTION
 // ============================================================================
@@ -13,31 +7,203 @@ int max_depth;                      // Maximum depth to search
 int main(int argc, char *argv[]) {
     // Check for help flag
     if (argc == 2 && strcmp(argv[1], "-h") == 0) {
-        printf("USAGE: crawler <url-1> <url-2> <depth>\n");
+        printf("USAGE: crawler [options] <url-1> <url-2> <depth>\n");
+        printf("       crawler [options] --resume <file>\n");
+        printf("       crawler [options] --batch <file>\n");
+        printf("       crawler [options] --serve <socket>\n");
+        printf("\n");
+        printf("--batch and --serve can't be combined with each other, with --checkpoint\n");
+        printf("or --resume, or with <url-1> <url-2> <depth>\n");
         printf("\n");
         printf("Arguments:\n");
         printf("  <url-1>   Starting Wikipedia article URL\n");
         printf("  <url-2>   Target Wikipedia article URL\n");
         printf("  <depth>   Maximum depth to search\n");
         printf("\n");
+        printf("Options:\n");
+        printf("  --checkpoint <file>             Periodically save crawl state to <file>\n");
+        printf("  --checkpoint-interval <seconds> Time between checkpoints (default %d)\n",
+               CHECKPOINT_INTERVAL);
+        printf("  --resume <file>                 Continue a crawl from a checkpoint\n");
+        printf("  --batch <file>                  Answer one query per line (\"<url-1> <url-2> <depth>\")\n");
+        printf("                                  from <file> or - for stdin, as JSON lines\n");
+        printf("  --serve <socket>                Answer batch-style queries on a Unix socket\n");
+        printf("  --stats <seconds>               Print a stats line to stderr every <seconds>\n");
+        printf("  --metrics <file>                Write Prometheus-format metrics to <file>\n");
+        printf("                                  (on every stats line and at exit)\n");
+        printf("  --visited-memory <MB>           Memory for the visited set's Bloom filter (default %d)\n",
+               VISITED_FILTER_MB);
+        printf("  --visited-fp <rate>             False positive rate the filter is tuned for (default %g)\n",
+               VISITED_FP_RATE);
+        printf("  --prefetch <entries>            Download the best of the next <entries> queued pages\n");
+        printf("                                  in the background (default 0 = off); with --batch\n");
+        printf("                                  or --serve, the best <entries> pages of each query's\n");
+        printf("                                  frontier (default %d)\n", QUERY_FETCH_AHEAD);
+        printf("  --no-io-uring                   Use plain stdio for the page cache\n");
+        printf("  --quiet                         Don't print a line for every page crawled\n");
+        printf("  --base-url <url>                Site that /wiki/ links point to (default: taken from\n");
+        printf("                                  <url-1> or the first query, or https://en.wikipedia.org)\n");
+        printf("\n");
         printf("Example:\n");
         printf("  crawler https://en.wikipedia.org/wiki/Linux ");
         printf("https://en.wikipedia.org/wiki/Rutgers_University-Camden 6\n");
         return 0;
     }
     
+    // Parse options (they come before the positional arguments)
+    char *resume_path = NULL;
+    char *batch_path = NULL;
+    char *serve_path = NULL;
+    char *metrics_path = NULL;
+    char *base_url = NULL;
+    int stats_interval = 0;
+    int prefetch_given = 0;
+    int arg_index = 1;
+    while (arg_index < argc && strncmp(argv[arg_index], "--", 2) == 0) {
+        // Flags without a value
+        if (strcmp(argv[arg_index], "--quiet") == 0) {
+            log_pages = 0;
+            arg_index++;
+            continue;
+        }
+        if (strcmp(argv[arg_index], "--no-io-uring") == 0) {
+            cache_io_uring = 0;
+            arg_index++;
+            continue;
+        }
+        
+        if (arg_index + 1 >= argc) {
+            fprintf(stderr, "Error: Option %s needs a value\n", argv[arg_index]);
+            return 1;
+        }
+        if (strcmp(argv[arg_index], "--checkpoint") == 0) {
+            checkpoint_path = argv[arg_index + 1];
+        } else if (strcmp(argv[arg_index], "--checkpoint-interval") == 0) {
+            checkpoint_interval = atoi(argv[arg_index + 1]);
+            if (checkpoint_interval <= 0) {
+                fprintf(stderr, "Error: Checkpoint interval must be a positive number\n");
+                return 1;
+            }
+        } else if (strcmp(argv[arg_index], "--resume") == 0) {
+            resume_path = argv[arg_index + 1];
+        } else if (strcmp(argv[arg_index], "--batch") == 0) {
+            batch_path = argv[arg_index + 1];
+        } else if (strcmp(argv[arg_index], "--serve") == 0) {
+            serve_path = argv[arg_index + 1];
+        } else if (strcmp(argv[arg_index], "--stats") == 0) {
+            stats_interval = atoi(argv[arg_index + 1]);
+            if (stats_interval <= 0) {
+                fprintf(stderr, "Error: Stats interval must be a positive number\n");
+                return 1;
+            }
+        } else if (strcmp(argv[arg_index], "--metrics") == 0) {
+            metrics_path = argv[arg_index + 1];
+        } else if (strcmp(argv[arg_index], "--visited-memory") == 0) {
+            visited_memory_mb = atoi(argv[arg_index + 1]);
+            if (visited_memory_mb <= 0) {
+                fprintf(stderr, "Error: Visited memory must be a positive number of MB\n");
+                return 1;
+            }
+        } else if (strcmp(argv[arg_index], "--visited-fp") == 0) {
+            visited_fp_rate = atof(argv[arg_index + 1]);
+            if (visited_fp_rate <= 0 || visited_fp_rate >= 1) {
+                fprintf(stderr, "Error: False positive rate must be between 0 and 1\n");
+                return 1;
+            }
+        } else if (strcmp(argv[arg_index], "--prefetch") == 0) {
+            prefetch_budget = atoi(argv[arg_index + 1]);
+            prefetch_given = 1;
+            if (prefetch_budget < 0) {
+                fprintf(stderr, "Error: Prefetch budget can't be negative\n");
+                return 1;
+            }
+        } else if (strcmp(argv[arg_index], "--base-url") == 0) {
+            base_url = argv[arg_index + 1];
+            wiki_base = base_url;
+        } else {
+            fprintf(stderr, "Error: Unknown option %s\n", argv[arg_index]);
+            fprintf(stderr, "Use '%s -h' for more information\n", argv[0]);
+            return 1;
+        }
+        arg_index += 2;
+    }
+    
+    // Batch and server modes answer many queries over one shared link graph
+    if (batch_path != NULL || serve_path != NULL) {
+        if (batch_path != NULL && serve_path != NULL) {
+            fprintf(stderr, "Error: --batch and --serve can't be used together\n");
+            return 1;
+        }
+        if (resume_path != NULL || checkpoint_path != NULL) {
+            fprintf(stderr, "Error: --resume and --checkpoint can't be used "
+                            "with --batch or --serve\n");
+            return 1;
+        }
+        if (arg_index != argc) {
+            fprintf(stderr, "Error: --batch and --serve take their queries from the input, "
+                            "not <url-1> <url-2> <depth>\n");
+            return 1;
+        }
+        
+        // Queries fetch the top of their frontiers ahead unless told otherwise
+        if (!prefetch_given) {
+            prefetch_budget = QUERY_FETCH_AHEAD;
+        }
+        // Links point back at the site the queries are about
+        wiki_base_from_query = (base_url == NULL);
+        
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        init_queue();
+        init_cache();
+        init_aliases();
+        init_link_graph();
+        start_stats(stats_interval, metrics_path);
+        
+        int result = batch_path ? run_batch(batch_path) : run_server(serve_path);
+        
+        stop_stats();
+        curl_global_cleanup();
+        return result;
+    }
+    
     // Check correct number of arguments
-    if (argc != 4) {
+    int positional = argc - arg_index;
+    if ((resume_path == NULL && positional != 3) || (resume_path != NULL && positional != 0)) {
         fprintf(stderr, "Error: Invalid number of arguments\n");
-        fprintf(stderr, "Usage: %s <url-1> <url-2> <depth>\n", argv[0]);
+        fprintf(stderr, "Usage: %s [options] <url-1> <url-2> <depth>\n", argv[0]);
+        fprintf(stderr, "       %s [options] --resume <file>\n", argv[0]);
+        fprintf(stderr, "       %s [options] --batch <file>\n", argv[0]);
+        fprintf(stderr, "       %s [options] --serve <socket>\n", argv[0]);
         fprintf(stderr, "Use '%s -h' for more information\n", argv[0]);
         return 1;
     }
     
-    // Parse arguments
-    char *start_url = argv[1];
-    target_url = argv[2];
-    max_depth = atoi(argv[3]);
+    // Initialize data structures
+    init_queue();
+    if (init_visited_set() != 0) {
+        return 1;
+    }
+    
+    // Parse arguments, or load them from the checkpoint
+    char *start_url;
+    if (resume_path != NULL) {
+        if (load_checkpoint(resume_path, &start_url) != 0) {
+            return 1;
+        }
+        // Keep checkpointing to the same file unless told otherwise
+        if (checkpoint_path == NULL) {
+            checkpoint_path = resume_path;
+        }
+    } else {
+        start_url = argv[arg_index];
+        target_url = argv[arg_index + 1];
+        max_depth = atoi(argv[arg_index + 2]);
+    }
+    
+    // Links on the pages we crawl point back at the same site as the start page
+    if (base_url == NULL) {
+        set_wiki_base_from_url(start_url);
+    }
     
     // Validate depth
     if (max_depth <= 0) {
@@ -45,27 +211,43 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    // Record start time
-    time_t start_time = time(NULL);
+    // Record start time (monotonic, so clock changes don't skew it)
+    double start_time = monotonic_seconds();
     
     // Initialize curl globally
     curl_global_init(CURL_GLOBAL_DEFAULT);
     
-    // Initialize data structures
-    init_queue();
-    init_visited_set();
     init_cache();
+    init_aliases();
+    
+    // Compare pages by their canonical URLs, following redirects we already know about
+    char start_canonical[2048], target_canonical[2048];
+    canonicalize_url(start_url, start_canonical, sizeof(start_canonical));
+    canonicalize_url(target_url, target_canonical, sizeof(target_canonical));
+    start_url = (char *)resolve_link(start_canonical);
+    target_url = (char *)resolve_link(target_canonical);
     
     printf("Finding path from %s to %s.\n\n", start_url, target_url);
     
     // Mark start URL as visited and add to queue
-    mark_visited(start_url);
-    enqueue(start_url, 0, NULL);
+    // (a resumed crawl already has its queue and visited set)
+    if (resume_path == NULL) {
+        mark_visited(start_url);
+        enqueue(start_url, 0, NULL);
+    }
+    
+    // Background helpers: checkpoints, stats and the page logger
+    start_checkpointer(start_url);
+    start_stats(stats_interval, metrics_path);
+    start_logger();
+    start_prefetcher();
     
     // Create worker threads
     pthread_t threads[NUM_THREADS];
+    int worker_ids[NUM_THREADS];
     for (int i = 0; i < NUM_THREADS; i++) {
-        if (pthread_create(&threads[i], NULL, crawl_worker, NULL) != 0) {
+        worker_ids[i] = i;
+        if (pthread_create(&threads[i], NULL, crawl_worker, &worker_ids[i]) != 0) {
             fprintf(stderr, "Error creating thread %d\n", i);
             return 1;
         }
@@ -76,6 +258,11 @@ int main(int argc, char *argv[]) {
         pthread_join(threads[i], NULL);
     }
     
+    stop_prefetcher();
+    stop_checkpointer();
+    stop_logger();
+    stop_stats();
+    
     printf("\n");
     
     // Check if we found the target
@@ -86,8 +273,7 @@ int main(int argc, char *argv[]) {
     }
     
     // Calculate and display runtime
-    time_t end_time = time(NULL);
-    double elapsed = difftime(end_time, start_time);
+    double elapsed = monotonic_seconds() - start_time;
     
     printf("\n");
     printf("Total runtime: %.2f seconds\n", elapsed);
@@ -0,0 +1,334 @@
+#include "crawler.h"
+#include <errno.h>
+
+// ============================================================================
+// METRICS (per-thread counters and latency histograms)
+// ============================================================================
+
+// Every thread gets its own ThreadMetrics slot, so updating a counter touches no
+// lock or shared cache line. Counters are relaxed atomics because the stats
+// thread adds the slots together while the owners keep counting; a total read
+// while the crawl is running may be a few updates behind.
+// Threads past MAX_METRIC_THREADS all count into the extra overflow slot at the
+// end, which the atomics also make safe to share.
+static ThreadMetrics metric_slots[MAX_METRIC_THREADS + 1];
+static ThreadMetrics *overflow_metrics = &metric_slots[MAX_METRIC_THREADS];
+static int metric_slot_count = 0;
+static int metric_overflow_used = 0;
+static pthread_mutex_t metric_slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local ThreadMetrics *my_metrics = NULL;
+
+// Relaxed read of a counter another thread may be updating
+#define METRIC_READ(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+
+// Names used when printing each timer (indexed by TIMER_*)
+static const char *TIMER_NAMES[NUM_TIMERS] = {
+    "fetch",
+    "cache_read",
+    "parse",
+    "enqueue_lock_wait",
+    "visited_lock_wait",
+};
+
+// Stats thread state
+static pthread_t stats_thread;
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stats_cond = PTHREAD_COND_INITIALIZER;
+static int stats_running = 0;
+static int stats_stop = 0;
+static int stats_interval = 0;
+static const char *stats_metrics_path = NULL;
+static double stats_start_time;
+
+// Current CLOCK_MONOTONIC time in nanoseconds
+long long now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Current CLOCK_MONOTONIC time in seconds
+double monotonic_seconds() {
+    return now_ns() / 1e9;
+}
+
+// Get the calling thread's metrics slot, claiming one on first use
+// If there are more threads than slots, the extra threads share the overflow slot
+ThreadMetrics *thread_metrics() {
+    if (my_metrics == NULL) {
+        pthread_mutex_lock(&metric_slot_lock);
+        if (metric_slot_count < MAX_METRIC_THREADS) {
+            my_metrics = &metric_slots[metric_slot_count++];
+        } else {
+            my_metrics = overflow_metrics;
+            metric_overflow_used = 1;
+        }
+        pthread_mutex_unlock(&metric_slot_lock);
+    }
+    return my_metrics;
+}
+
+// Record how long something took, given the now_ns() value when it started
+// Bucket 0 holds times under 1us; bucket i holds times under 2^i us
+void record_timer(int timer, long long start_ns) {
+    long long elapsed = now_ns() - start_ns;
+    LatencyHistogram *histogram = &thread_metrics()->timers[timer];
+    
+    int bucket = 0;
+    long long micros = elapsed / 1000;
+    while (micros > 0 && bucket < METRIC_BUCKETS - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_ns, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->buckets[bucket], 1, memory_order_relaxed);
+}
+
+// Add up every thread's metrics into total
+void collect_metrics(ThreadMetrics *total) {
+    memset(total, 0, sizeof(ThreadMetrics));
+    
+    pthread_mutex_lock(&metric_slot_lock);
+    int slots = metric_slot_count;
+    pthread_mutex_unlock(&metric_slot_lock);
+    
+    // The overflow slot is always added; it stays zero until a thread uses it
+    for (int i = 0; i <= slots; i++) {
+        ThreadMetrics *slot = (i < slots) ? &metric_slots[i] : overflow_metrics;
+        total->pages += METRIC_READ(slot->pages);
+        total->cache_hits += METRIC_READ(slot->cache_hits);
+        total->prefetched += METRIC_READ(slot->prefetched);
+        total->cache_misses += METRIC_READ(slot->cache_misses);
+        total->fetch_errors += METRIC_READ(slot->fetch_errors);
+        total->links_found += METRIC_READ(slot->links_found);
+        for (int t = 0; t < NUM_TIMERS; t++) {
+            total->timers[t].count += METRIC_READ(slot->timers[t].count);
+            total->timers[t].total_ns += METRIC_READ(slot->timers[t].total_ns);
+            for (int b = 0; b < METRIC_BUCKETS; b++) {
+                total->timers[t].buckets[b] += METRIC_READ(slot->timers[t].buckets[b]);
+            }
+        }
+    }
+}
+
+// Estimate a percentile (0-100) from a histogram, in milliseconds
+// Returns the upper bound of the bucket the percentile falls in
+static double histogram_percentile_ms(LatencyHistogram *histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    
+    unsigned long wanted = (unsigned long)(histogram->count * percentile / 100.0);
+    unsigned long seen = 0;
+    for (int b = 0; b < METRIC_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen > wanted) {
+            return (double)(1LL << b) / 1000.0;
+        }
+    }
+    return (double)(1LL << (METRIC_BUCKETS - 1)) / 1000.0;
+}
+
+// Average time in a histogram, in milliseconds
+static double histogram_average_ms(LatencyHistogram *histogram) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    return histogram->total_ns / 1e6 / histogram->count;
+}
+
+// Print one stats line to stderr
+// pages_per_second is measured since the previous line
+static void print_stats_line(ThreadMetrics *total, double pages_per_second) {
+    pthread_mutex_lock(&url_queue.lock);
+    int frontier = url_queue.size;
+    pthread_mutex_unlock(&url_queue.lock);
+    
+    fprintf(stderr,
+            "[stats] %.1fs pages=%lu (%.1f/s) frontier=%d cache hit/miss=%lu/%lu errors=%lu "
+            "fetch p50/p99=%.1f/%.1fms parse avg=%.2fms "
+            "queue wait avg=%.3fms visited wait avg=%.3fms\n",
+            monotonic_seconds() - stats_start_time,
+            total->pages, pages_per_second, frontier,
+            total->cache_hits, total->cache_misses, total->fetch_errors,
+            histogram_percentile_ms(&total->timers[TIMER_FETCH], 50),
+            histogram_percentile_ms(&total->timers[TIMER_FETCH], 99),
+            histogram_average_ms(&total->timers[TIMER_PARSE]),
+            histogram_average_ms(&total->timers[TIMER_ENQUEUE_WAIT]),
+            histogram_average_ms(&total->timers[TIMER_VISITED_WAIT]));
+}
+
+// Write all metrics to a file in Prometheus text format
+// The file is written under a temporary name and renamed, so a scraper never
+// sees half a file. Returns 0 on success, -1 on error
+int write_metrics(const char *path) {
+    char temp_path[1024];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    
+    FILE *f = fopen(temp_path, "w");
+    if (!f) {
+        fprintf(stderr, "Error writing metrics %s\n", path);
+        return -1;
+    }
+    
+    ThreadMetrics total;
+    collect_metrics(&total);
+    
+    pthread_mutex_lock(&url_queue.lock);
+    int frontier = url_queue.size;
+    pthread_mutex_unlock(&url_queue.lock);
+    
+    // The visited set only exists for single crawls
+    unsigned long visited = 0, capacity = 0, exact_checks = 0, false_positives = 0;
+    if (visited_set.filter != NULL) {
+        pthread_mutex_lock(&visited_set.lock);
+        visited = visited_set.count;
+        capacity = visited_set.filter_capacity;
+        exact_checks = visited_set.exact_checks;
+        false_positives = visited_set.false_positives;
+        pthread_mutex_unlock(&visited_set.lock);
+    }
+    
+    fprintf(f, "# TYPE crawler_pages_total counter\ncrawler_pages_total %lu\n", total.pages);
+    fprintf(f, "# TYPE crawler_cache_hits_total counter\ncrawler_cache_hits_total %lu\n", total.cache_hits);
+    fprintf(f, "# TYPE crawler_cache_misses_total counter\ncrawler_cache_misses_total %lu\n", total.cache_misses);
+    fprintf(f, "# TYPE crawler_fetch_errors_total counter\ncrawler_fetch_errors_total %lu\n", total.fetch_errors);
+    fprintf(f, "# TYPE crawler_prefetched_total counter\ncrawler_prefetched_total %lu\n", total.prefetched);
+    fprintf(f, "# TYPE crawler_links_found_total counter\ncrawler_links_found_total %lu\n", total.links_found);
+    fprintf(f, "# TYPE crawler_log_lines_dropped_total counter\ncrawler_log_lines_dropped_total %lu\n",
+            log_lines_dropped);
+    fprintf(f, "# TYPE crawler_frontier_size gauge\ncrawler_frontier_size %d\n", frontier);
+    fprintf(f, "# TYPE crawler_visited_urls gauge\ncrawler_visited_urls %lu\n", visited);
+    fprintf(f, "# TYPE crawler_visited_filter_capacity gauge\ncrawler_visited_filter_capacity %lu\n",
+            capacity);
+    fprintf(f, "# TYPE crawler_visited_exact_checks_total counter\ncrawler_visited_exact_checks_total %lu\n",
+            exact_checks);
+    fprintf(f, "# TYPE crawler_visited_false_positives_total counter\n"
+            "crawler_visited_false_positives_total %lu\n", false_positives);
+    fprintf(f, "# TYPE crawler_uptime_seconds gauge\ncrawler_uptime_seconds %.3f\n",
+            monotonic_seconds() - stats_start_time);
+    
+    // Pages crawled by each thread, to spot idle or stuck workers
+    pthread_mutex_lock(&metric_slot_lock);
+    int slots = metric_slot_count;
+    int overflow_used = metric_overflow_used;
+    pthread_mutex_unlock(&metric_slot_lock);
+    fprintf(f, "# TYPE crawler_thread_pages_total counter\n");
+    for (int i = 0; i < slots; i++) {
+        fprintf(f, "crawler_thread_pages_total{thread=\"%d\"} %lu\n",
+                i, METRIC_READ(metric_slots[i].pages));
+    }
+    if (overflow_used) {
+        fprintf(f, "crawler_thread_pages_total{thread=\"overflow\"} %lu\n",
+                METRIC_READ(overflow_metrics->pages));
+    }
+    
+    // One histogram per timer, with cumulative buckets as Prometheus expects
+    for (int t = 0; t < NUM_TIMERS; t++) {
+        LatencyHistogram *histogram = &total.timers[t];
+        fprintf(f, "# TYPE crawler_%s_seconds histogram\n", TIMER_NAMES[t]);
+        
+        unsigned long cumulative = 0;
+        for (int b = 0; b < METRIC_BUCKETS - 1; b++) {
+            cumulative += histogram->buckets[b];
+            fprintf(f, "crawler_%s_seconds_bucket{le=\"%g\"} %lu\n",
+                    TIMER_NAMES[t], (double)(1LL << b) / 1e6, cumulative);
+        }
+        fprintf(f, "crawler_%s_seconds_bucket{le=\"+Inf\"} %lu\n", TIMER_NAMES[t], histogram->count);
+        fprintf(f, "crawler_%s_seconds_sum %.9f\n", TIMER_NAMES[t], histogram->total_ns / 1e9);
+        fprintf(f, "crawler_%s_seconds_count %lu\n", TIMER_NAMES[t], histogram->count);
+    }
+    
+    if (fclose(f) != 0 || rename(temp_path, path) != 0) {
+        fprintf(stderr, "Error writing metrics %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Background thread that prints a stats line (and rewrites the metrics file)
+// every stats_interval seconds
+static void *stats_loop(void *arg) {
+    (void)arg; // Unused parameter
+    
+    unsigned long last_pages = 0;
+    double last_time = monotonic_seconds();
+    
+    pthread_mutex_lock(&stats_mutex);
+    while (!stats_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += stats_interval;
+        
+        // Sleep until the deadline, waking early only when asked to stop
+        int rc = 0;
+        while (!stats_stop && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&stats_cond, &stats_mutex, &deadline);
+        }
+        if (stats_stop) {
+            break;
+        }
+        pthread_mutex_unlock(&stats_mutex);
+        
+        ThreadMetrics total;
+        collect_metrics(&total);
+        double now = monotonic_seconds();
+        print_stats_line(&total, (total.pages - last_pages) / (now - last_time));
+        last_pages = total.pages;
+        last_time = now;
+        
+        if (stats_metrics_path != NULL) {
+            write_metrics(stats_metrics_path);
+        }
+        
+        pthread_mutex_lock(&stats_mutex);
+    }
+    pthread_mutex_unlock(&stats_mutex);
+    
+    return NULL;
+}
+
+// Start reporting metrics
+// interval > 0 prints a stats line every interval seconds; metrics_path (may be
+// NULL) is rewritten in Prometheus format on every line and when stats stop
+void start_stats(int interval, const char *metrics_path) {
+    stats_start_time = monotonic_seconds();
+    stats_interval = interval;
+    stats_metrics_path = metrics_path;
+    
+    // Without an interval the metrics file is only written at the end
+    if (interval <= 0) {
+        return;
+    }
+    
+    stats_stop = 0;
+    if (pthread_create(&stats_thread, NULL, stats_loop, NULL) != 0) {
+        fprintf(stderr, "Error creating stats thread\n");
+        return;
+    }
+    stats_running = 1;
+}
+
+// Stop the stats thread, print a final stats line and write the metrics file
+void stop_stats() {
+    if (stats_running) {
+        pthread_mutex_lock(&stats_mutex);
+        stats_stop = 1;
+        pthread_cond_signal(&stats_cond);
+        pthread_mutex_unlock(&stats_mutex);
+        
+        pthread_join(stats_thread, NULL);
+        stats_running = 0;
+        
+        ThreadMetrics total;
+        collect_metrics(&total);
+        double elapsed = monotonic_seconds() - stats_start_time;
+        print_stats_line(&total, elapsed > 0 ? total.pages / elapsed : 0);
+    }
+    
+    if (stats_metrics_path != NULL) {
+        write_metrics(stats_metrics_path);
+    }
+}
@@ -25,6 +25,21 @@ void add_url_to_list(URLList *list, const char *url) {
     list->count++;
 }
 
+// Set wiki_base from an article URL (everything before "/wiki/")
+// Leaves wiki_base unchanged if the URL has no "/wiki/" part
+void set_wiki_base_from_url(const char *url) {
+    const char *wiki = strstr(url, "/wiki/");
+    if (wiki == NULL) {
+        return;
+    }
+    
+    size_t length = wiki - url;
+    char *base = malloc(length + 1);
+    memcpy(base, url, length);
+    base[length] = '\0';
+    wiki_base = base;
+}
+
 // Check if a string starts with a given prefix
 int starts_with(const char *str, const char *prefix) {
     return strncmp(str, prefix, strlen(prefix)) == 0;
@@ -89,50 +104,88 @@ int is_valid_wiki_link(const char *href) {
 }
 
 // Recursively search for <a> tags in the HTML tree
-void search_for_links(GumboNode *node, URLList *list) {
+// The href of the page's <link rel="canonical">, if any, is stored in *canonical_href
+void search_for_links(GumboNode *node, URLList *list, const char **canonical_href) {
     if (node->type != GUMBO_NODE_ELEMENT) {
         return;
     }
     
+    // Wikipedia names the article a page really is in a canonical link in <head>
+    if (node->v.element.tag == GUMBO_TAG_LINK) {
+        GumboAttribute *rel = gumbo_get_attribute(&node->v.element.attributes, "rel");
+        GumboAttribute *href = gumbo_get_attribute(&node->v.element.attributes, "href");
+        if (rel && href && strcmp(rel->value, "canonical") == 0) {
+            *canonical_href = href->value;
+        }
+    }
+    
     // If this is an <a> tag, extract the href
     if (node->v.element.tag == GUMBO_TAG_A) {
         GumboAttribute *href = gumbo_get_attribute(&node->v.element.attributes, "href");
         if (href && is_valid_wiki_link(href->value)) {
             // Build full URL
             char full_url[1024];
-            snprintf(full_url, sizeof(full_url), "https://en.wikipedia.org%s", href->value);
+            snprintf(full_url, sizeof(full_url), "%s%s", wiki_base, href->value);
             
-            // Remove anchor (everything after #)
-            char *anchor = strchr(full_url, '#');
-            if (anchor) {
-                *anchor = '\0';
-            }
+            // Canonicalize it (drops the #anchor, ?query and encoding differences)
+            char canonical[1024];
+            canonicalize_url(full_url, canonical, sizeof(canonical));
             
-            add_url_to_list(list, full_url);
+            add_url_to_list(list, canonical);
         }
     }
     
     // Recursively search children
     GumboVector *children = &node->v.element.children;
     for (unsigned int i = 0; i < children->length; i++) {
-        search_for_links((GumboNode *)children->data[i], list);
+        search_for_links((GumboNode *)children->data[i], list, canonical_href);
     }
 }
 
+// Remember that url is another name for the article its page says it is
+// Wikipedia answers a redirect title like "GNU/Linux" with a 200 and the
+// article's content, so the page's canonical link is the only sign of it
+static void record_canonical_link(const char *url, const char *href, const char *html) {
+    char full_url[2048];
+    if (starts_with(href, "/wiki/")) {
+        snprintf(full_url, sizeof(full_url), "%s%s", wiki_base, href);
+    } else {
+        snprintf(full_url, sizeof(full_url), "%s", href);
+    }
+    
+    char canonical[2048];
+    canonicalize_url(full_url, canonical, sizeof(canonical));
+    if (!starts_with(canonical, "http") || !record_alias(url, canonical)) {
+        return;
+    }
+    
+    // Cache the article under its own name too, so it isn't downloaded again
+    write_to_cache(canonical, html);
+}
+
 // Parse HTML and extract Wikipedia links
+// url is the page's own URL; if the page names a different canonical article,
+// url is recorded as an alias for it (pass NULL to skip this)
 // Returns a URLList containing all found links
-URLList *parse_html(const char *html) {
+URLList *parse_html(const char *url, const char *html) {
+    long long start = now_ns();
     URLList *list = create_url_list();
     
     // Parse the HTML
     GumboOutput *output = gumbo_parse(html);
     
     // Search for links starting from the root
-    search_for_links(output->root, list);
+    const char *canonical_href = NULL;
+    search_for_links(output->root, list, &canonical_href);
+    if (url != NULL && canonical_href != NULL) {
+        record_canonical_link(url, canonical_href, html);
+    }
     
     // Clean up gumbo
     gumbo_destroy_output(&kGumboDefaultOptions, output);
     
+    record_timer(TIMER_PARSE, start);
+    METRIC_ADD(links_found, list->count);
     return list;
 }
 
@@ -0,0 +1,168 @@
+#include "crawler.h"
+
+// ============================================================================
+// SPECULATIVE PREFETCHING
+// ============================================================================
+
+// Workers only start fetching a page after they dequeue it, so every page
+// begins with a network wait. The queue is kept sorted by calculate_priority,
+// so the next pages to be crawled are the ones at its head. Prefetch threads
+// download the best of the first prefetch_budget entries into the page cache
+// ahead of time, so a worker that dequeues one usually finds it already
+// cached. Pages deeper than max_depth are skipped, since workers never fetch them.
+
+static pthread_t prefetch_threads[PREFETCH_THREADS];
+static int prefetch_ids[PREFETCH_THREADS];
+static int prefetch_running = 0;
+
+// Set once the target is found or the crawl is over; also aborts downloads in progress
+static atomic_int prefetch_cancel;
+
+// URL each prefetch thread is downloading right now (NULL if none)
+static const char *prefetching[PREFETCH_THREADS];
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+
+// Claim the best page near the head of the queue that nobody has prefetched yet
+// and record it as thread id's current download
+// Returns NULL if there is nothing to prefetch
+static URLQueueNode *claim_next_page(int id) {
+    URLQueueNode *claimed = NULL;
+    
+    pthread_mutex_lock(&url_queue.lock);
+    if (url_queue.found) {
+        atomic_store(&prefetch_cancel, 1);
+    }
+    
+    int checked = 0;
+    for (URLQueueNode *node = url_queue.head; node != NULL && checked < prefetch_budget;
+         node = node->next, checked++) {
+        if (!node->prefetched && node->depth < max_depth) {
+            node->prefetched = 1;
+            claimed = node;
+            break;
+        }
+    }
+    
+    // Recorded before the queue is unlocked, so a worker that dequeues
+    // this page will wait for the download instead of starting its own
+    if (claimed != NULL) {
+        pthread_mutex_lock(&prefetch_lock);
+        prefetching[id] = claimed->url;
+        pthread_mutex_unlock(&prefetch_lock);
+    }
+    pthread_mutex_unlock(&url_queue.lock);
+    
+    return claimed;
+}
+
+// Mark thread id's download as finished and wake any worker waiting for it
+static void finish_download(int id) {
+    pthread_mutex_lock(&prefetch_lock);
+    prefetching[id] = NULL;
+    pthread_cond_broadcast(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+// Prefetch thread: keep the cache warm for the pages at the head of the queue
+static void *prefetch_loop(void *arg) {
+    int id = *(int *)arg;
+    
+    while (!atomic_load(&prefetch_cancel)) {
+        URLQueueNode *node = claim_next_page(id);
+        if (node == NULL) {
+            // Nothing to do - check again shortly, or when asked to stop
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += 20 * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            
+            pthread_mutex_lock(&prefetch_lock);
+            if (!atomic_load(&prefetch_cancel)) {
+                pthread_cond_timedwait(&prefetch_cond, &prefetch_lock, &deadline);
+            }
+            pthread_mutex_unlock(&prefetch_lock);
+            continue;
+        }
+        
+        // Pages already in the cache don't need downloading
+        char filename[512];
+        url_to_cache_filename(node->url, filename, sizeof(filename));
+        if (access(filename, F_OK) != 0) {
+            char *html = download_url(node->url, &prefetch_cancel);
+            if (html != NULL) {
+                METRIC_ADD(prefetched, 1);
+                free(html);
+            }
+        }
+        
+        // The page must be in the cache before a waiting worker looks for it
+        flush_cache_writes();
+        finish_download(id);
+    }
+    
+    return NULL;
+}
+
+// Start the prefetch threads (does nothing if prefetch_budget is 0)
+void start_prefetcher() {
+    if (prefetch_budget <= 0) {
+        return;
+    }
+    
+    atomic_store(&prefetch_cancel, 0);
+    for (int i = 0; i < PREFETCH_THREADS; i++) {
+        prefetch_ids[i] = i;
+        prefetching[i] = NULL;
+        if (pthread_create(&prefetch_threads[i], NULL, prefetch_loop, &prefetch_ids[i]) != 0) {
+            fprintf(stderr, "Error creating prefetch thread %d\n", i);
+            break;
+        }
+        prefetch_running++;
+    }
+}
+
+// Abandon all prefetching, including downloads in progress
+// Called as soon as the target is found
+void cancel_prefetch() {
+    atomic_store(&prefetch_cancel, 1);
+    
+    pthread_mutex_lock(&prefetch_lock);
+    pthread_cond_broadcast(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+// Cancel prefetching and wait for the prefetch threads to exit
+void stop_prefetcher() {
+    cancel_prefetch();
+    for (int i = 0; i < prefetch_running; i++) {
+        pthread_join(prefetch_threads[i], NULL);
+    }
+    prefetch_running = 0;
+}
+
+// If a prefetch thread is downloading url right now, wait until it is done,
+// so the page is read from the cache instead of being fetched twice
+void wait_for_prefetch(const char *url) {
+    if (prefetch_running == 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&prefetch_lock);
+    int busy = 1;
+    while (busy) {
+        busy = 0;
+        for (int i = 0; i < PREFETCH_THREADS; i++) {
+            if (prefetching[i] != NULL && strcmp(prefetching[i], url) == 0) {
+                busy = 1;
+            }
+        }
+        if (busy) {
+            pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+        }
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+}
@@ -9,28 +9,32 @@
 void init_queue() {
     url_queue.head = NULL;
     url_queue.tail = NULL;
+    url_queue.size = 0;
     url_queue.active_threads = 0;
     url_queue.found = 0;
     url_queue.target_node = NULL;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        url_queue.in_flight[i] = NULL;
+    }
     pthread_mutex_init(&url_queue.lock, NULL);
     pthread_cond_init(&url_queue.cond, NULL);
+    
+    // Workers take checkpoint_lock for reading on every page, so with glibc's
+    // default reader preference a checkpoint could wait for as long as any worker
+    // is expanding. Prefer the writer instead; this is safe because no thread
+    // ever takes the read lock twice
+    pthread_rwlockattr_t checkpoint_attr;
+    pthread_rwlockattr_init(&checkpoint_attr);
+#ifdef __GLIBC__
+    pthread_rwlockattr_setkind_np(&checkpoint_attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&url_queue.checkpoint_lock, &checkpoint_attr);
+    pthread_rwlockattr_destroy(&checkpoint_attr);
 }
 
-// Add a URL to the queue (priority-based insertion)
-// Creates a new node with the URL, depth, priority, and parent pointer
-// Higher priority URLs are inserted closer to the front
-void enqueue(const char *url, int depth, URLQueueNode *parent) {
-    // Create a new queue node
-    URLQueueNode *new_node = malloc(sizeof(URLQueueNode));
-    new_node->url = strdup(url);
-    new_node->depth = depth;
-    new_node->priority = calculate_priority(url, target_url);
-    new_node->parent = parent;
-    new_node->next = NULL;
-    
-    pthread_mutex_lock(&url_queue.lock);
-    
-    // Insert based on priority (higher priority = closer to front)
+// Insert a node into the queue by priority
+// Higher priority nodes go closer to the front. Caller must hold url_queue.lock
+static void insert_by_priority(URLQueueNode *new_node) {
     if (url_queue.head == NULL) {
         // Queue is empty
         url_queue.head = new_node;
@@ -55,6 +59,30 @@ void enqueue(const char *url, int depth, URLQueueNode *parent) {
             url_queue.tail = new_node;
         }
     }
+}
+
+// Add a URL to the queue (priority-based insertion)
+// Creates a new node with the URL, depth, priority, and parent pointer
+// Higher priority URLs are inserted closer to the front
+void enqueue(const char *url, int depth, URLQueueNode *parent) {
+    // Create a new queue node
+    URLQueueNode *new_node = malloc(sizeof(URLQueueNode));
+    new_node->url = strdup(url);
+    new_node->depth = depth;
+    new_node->priority = calculate_priority(url, target_url);
+    new_node->parent = parent;
+    new_node->next = NULL;
+    new_node->checkpoint_epoch = 0;
+    new_node->checkpoint_id = 0;
+    new_node->prefetched = 0;
+    
+    long long wait_start = now_ns();
+    pthread_mutex_lock(&url_queue.lock);
+    record_timer(TIMER_ENQUEUE_WAIT, wait_start);
+    
+    // Insert based on priority (higher priority = closer to front)
+    insert_by_priority(new_node);
+    url_queue.size++;
     
     // Signal one waiting thread that there's work available
     pthread_cond_signal(&url_queue.cond);
@@ -62,10 +90,31 @@ void enqueue(const char *url, int depth, URLQueueNode *parent) {
     pthread_mutex_unlock(&url_queue.lock);
 }
 
+// Put a node loaded from a checkpoint back into the queue
+// Sorted nodes arrive in queue order and are appended at the tail;
+// others (pages that were in flight) are inserted by priority
+void restore_node(URLQueueNode *node, int sorted) {
+    node->next = NULL;
+    
+    pthread_mutex_lock(&url_queue.lock);
+    
+    if (sorted && url_queue.tail != NULL) {
+        url_queue.tail->next = node;
+        url_queue.tail = node;
+    } else {
+        insert_by_priority(node);
+    }
+    url_queue.size++;
+    
+    pthread_mutex_unlock(&url_queue.lock);
+}
+
 // Remove and return a URL from the queue
 // Returns NULL if queue is empty and all threads are idle (work is done)
 // Blocks if queue is empty but other threads are still working
-URLQueueNode *dequeue() {
+// The caller counts as an active thread until it calls finish_node(), and the
+// node is recorded as in flight for worker_id (-1 to skip) so checkpoints can save it
+URLQueueNode *dequeue(int worker_id) {
     pthread_mutex_lock(&url_queue.lock);
     
     while (1) {
@@ -79,12 +128,18 @@ URLQueueNode *dequeue() {
         if (url_queue.head != NULL) {
             URLQueueNode *node = url_queue.head;
             url_queue.head = url_queue.head->next;
+            url_queue.size--;
             
             // If queue is now empty, update tail
             if (url_queue.head == NULL) {
                 url_queue.tail = NULL;
             }
             
+            if (worker_id >= 0) {
+                url_queue.in_flight[worker_id] = node;
+            }
+            url_queue.active_threads++;
+            
             pthread_mutex_unlock(&url_queue.lock);
             return node;
         }
@@ -101,3 +156,25 @@ URLQueueNode *dequeue() {
         pthread_cond_wait(&url_queue.cond, &url_queue.lock);
     }
 }
+
+// Called when a worker is done with the node it got from dequeue(), so
+// checkpoints stop saving it
+// If that was the last active thread and the queue is empty, wakes everyone up to exit
+// A worker that queued the page's links must call this while it still holds
+// checkpoint_lock for reading; otherwise a checkpoint could record the page as
+// in flight along with the children it just queued, and resuming would
+// expand the page (and queue its whole subtree) twice
+void finish_node(int worker_id) {
+    pthread_mutex_lock(&url_queue.lock);
+    
+    if (worker_id >= 0) {
+        url_queue.in_flight[worker_id] = NULL;
+    }
+    url_queue.active_threads--;
+    
+    if (url_queue.active_threads == 0 && url_queue.head == NULL) {
+        pthread_cond_broadcast(&url_queue.cond);
+    }
+    
+    pthread_mutex_unlock(&url_queue.lock);
+}
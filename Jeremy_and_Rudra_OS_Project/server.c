@@ -0,0 +1,124 @@
+#include "crawler.h"
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// ============================================================================
+// SERVER MODE (long-running local query service)
+// ============================================================================
+
+// The server listens on a Unix socket. A client writes query lines in the same
+// format as batch mode ("<url-1> <url-2> <depth> [timeout-seconds]") and gets
+// one JSON line back per query. A fixed pool of SERVER_THREADS threads accepts
+// connections, so many clients are answered at once. The link graph, page cache
+// and curl stay warm for the life of the process, so repeated or nearby queries
+// are answered from memory. Closing the connection cancels the query in progress;
+// a client that only shuts down its writing side still gets its results.
+
+static int server_socket = -1;
+
+// Answer queries from one client until it disconnects
+static void serve_client(int client_fd) {
+    FILE *in = fdopen(client_fd, "r");
+    int out_fd = dup(client_fd);
+    FILE *out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "Error: Cannot open client connection\n");
+        if (in != NULL) {
+            fclose(in);
+        } else {
+            close(client_fd);
+        }
+        if (out_fd >= 0) {
+            close(out_fd);
+        }
+        return;
+    }
+    
+    QueryLimits limits = { SERVER_QUERY_TIMEOUT, client_fd };
+    char line[4096];
+    long line_number = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        handle_query_line(out, line, ++line_number, &limits);
+    }
+    
+    fclose(out);
+    fclose(in);
+}
+
+// Server thread - accepts clients and serves them one at a time
+static void *server_worker(void *arg) {
+    (void)arg; // Unused parameter
+    
+    while (1) {
+        int client_fd = accept(server_socket, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            fprintf(stderr, "Error accepting connection: %s\n", strerror(errno));
+            break;
+        }
+        
+        serve_client(client_fd);
+    }
+    
+    return NULL;
+}
+
+// Listen on a Unix socket and answer path queries until killed
+// Returns 1 if the server could not start
+int run_server(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path %s is too long\n", socket_path);
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    
+    // A client that disconnects mid-reply must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+    
+    server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_socket < 0) {
+        fprintf(stderr, "Error creating socket: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    // Remove a stale socket left by a previous run
+    unlink(socket_path);
+    if (bind(server_socket, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server_socket, 64) != 0) {
+        fprintf(stderr, "Error listening on %s: %s\n", socket_path, strerror(errno));
+        close(server_socket);
+        return 1;
+    }
+    
+    printf("Listening on %s with %d threads\n", socket_path, SERVER_THREADS);
+    fflush(stdout);
+    
+    start_fetch_ahead();
+    
+    pthread_t threads[SERVER_THREADS];
+    int started = 0;
+    for (int i = 0; i < SERVER_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, server_worker, NULL) != 0) {
+            fprintf(stderr, "Error creating thread %d\n", i);
+            break;
+        }
+        started++;
+    }
+    
+    // Server threads only return if accept() fails for good
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    stop_fetch_ahead();
+    
+    close(server_socket);
+    unlink(socket_path);
+    return 1;
+}
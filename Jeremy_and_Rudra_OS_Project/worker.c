@@ -5,22 +5,13 @@
 // ============================================================================
 
 // Worker thread function - each thread runs this
+// arg points to the worker's index (0 to NUM_THREADS-1)
 void *crawl_worker(void *arg) {
-    (void)arg; // Unused parameter
+    int worker_id = *(int *)arg;
     
     while (1) {
-        // Increment active thread count before trying to get work
-        pthread_mutex_lock(&url_queue.lock);
-        url_queue.active_threads++;
-        pthread_mutex_unlock(&url_queue.lock);
-        
-        // Get a URL from the queue
-        URLQueueNode *node = dequeue();
-        
-        // Decrement active thread count
-        pthread_mutex_lock(&url_queue.lock);
-        url_queue.active_threads--;
-        pthread_mutex_unlock(&url_queue.lock);
+        // Get a URL from the queue (this thread counts as active until finish_node)
+        URLQueueNode *node = dequeue(worker_id);
         
         // If no URL, we're done
         if (node == NULL) {
@@ -29,25 +20,69 @@ void *crawl_worker(void *arg) {
         
         // Check if we've already reached max depth
         if (node->depth >= max_depth) {
+            finish_node(worker_id);
             continue;
         }
         
-        printf("Crawling: %s (depth %d)\n", node->url, node->depth);
+        if (log_pages) {
+            log_message("Crawling: %s (depth %d)\n", node->url, node->depth);
+        }
         
-        // Fetch the HTML content
+        // Fetch the HTML content (a prefetch thread may already be downloading it)
+        wait_for_prefetch(node->url);
         char *html = fetch_url(node->url);
         if (html == NULL) {
             // Error fetching - skip this URL
+            finish_node(worker_id);
             continue;
         }
         
+        METRIC_ADD(pages, 1);
+        
         // Parse HTML to extract links
-        URLList *links = parse_html(html);
-        free(html);
+        URLList *links = parse_html(node->url, html);
+        free_page(html);
+        
+        // Hold off checkpoints until the page's redirect and every new link are
+        // both marked and queued, so a snapshot never sees a half-expanded page
+        pthread_rwlock_rdlock(&url_queue.checkpoint_lock);
+        
+        // If the page redirected, it may be the target or an article we already have
+        const char *canonical = resolve_alias(node->url);
+        if (canonical != NULL) {
+            if (strcmp(canonical, target_url) == 0) {
+                // The redirect is the target: the path ends here under its real name
+                URLQueueNode *target_node = malloc(sizeof(URLQueueNode));
+                target_node->url = strdup(canonical);
+                target_node->depth = node->depth;
+                target_node->parent = node->parent;
+                target_node->next = NULL;
+                
+                pthread_mutex_lock(&url_queue.lock);
+                url_queue.found = 1;
+                url_queue.target_node = target_node;
+                pthread_cond_broadcast(&url_queue.cond);
+                pthread_mutex_unlock(&url_queue.lock);
+                cancel_prefetch();
+                
+                pthread_rwlock_unlock(&url_queue.checkpoint_lock);
+                free_url_list(links);
+                return NULL;
+            }
+            if (is_visited(canonical)) {
+                // Same article as one already queued or crawled
+                finish_node(worker_id);
+                pthread_rwlock_unlock(&url_queue.checkpoint_lock);
+                free_url_list(links);
+                continue;
+            }
+            mark_visited(canonical);
+        }
         
         // Process each link found
         for (int i = 0; i < links->count; i++) {
-            char *link = links->urls[i];
+            // Links are already canonical; follow any redirect we know about
+            const char *link = resolve_link(links->urls[i]);
             
             // Skip blacklisted URLs (common pages that lead everywhere)
             if (is_blacklisted(link)) {
@@ -80,7 +115,9 @@ void *crawl_worker(void *arg) {
                 // Wake up all waiting threads
                 pthread_cond_broadcast(&url_queue.cond);
                 pthread_mutex_unlock(&url_queue.lock);
+                cancel_prefetch();
                 
+                pthread_rwlock_unlock(&url_queue.checkpoint_lock);
                 free_url_list(links);
                 return NULL;
             }
@@ -89,6 +126,10 @@ void *crawl_worker(void *arg) {
             enqueue(link, node->depth + 1, node);
         }
         
+        // This page is fully expanded now
+        finish_node(worker_id);
+        pthread_rwlock_unlock(&url_queue.checkpoint_lock);
+        
         free_url_list(links);
     }
     